@@ -2,13 +2,25 @@
 #define CIMENU_H
 
 #include <CEvent.h>
+#include <CIMenuArena.h>
+#include <CIMenuBitSet.h>
+#include <CIMenuStringPool.h>
+#include <CTermOutput.h>
+#include <CTermScreen.h>
 
 #include <vector>
 #include <map>
+#include <memory>
+#include <chrono>
+#include <string_view>
 #include <sys/types.h>
 
 class CIMenuBase;
 class CIMenuItem;
+class CIMenuFile;
+class CIMenuFilter;
+class CIMenuHistory;
+class CIMenuReader;
 
 //---
 
@@ -16,6 +28,22 @@ class CIMenuItem;
 class CIMenuBox {
  public:
   typedef std::vector<CIMenuItem *> Items;
+  typedef std::vector<std::string>  Names;
+
+  // item data for bulk add
+  struct ItemData {
+    std::string name;
+    std::string command;
+    int         column { 1 };
+
+    ItemData() { }
+
+    ItemData(std::string name1, std::string command1="", int column1=1) :
+     name(std::move(name1)), command(std::move(command1)), column(column1) {
+    }
+  };
+
+  typedef std::vector<ItemData> ItemDatas;
 
   enum class BorderStyle {
     NONE,
@@ -23,11 +51,9 @@ class CIMenuBox {
   };
 
  public:
-  CIMenuBox(CIMenuBox *parent=nullptr) :
-   parent_(parent) {
-  }
+  CIMenuBox(CIMenuBox *parent=nullptr);
 
-  virtual ~CIMenuBox() { }
+  virtual ~CIMenuBox();
 
   //---
 
@@ -48,20 +74,88 @@ class CIMenuBox {
 
   CIMenuItem *item(int i) const { return items_[i]; }
 
-  void clearItems();
+  virtual void clearItems();
 
   virtual CIMenuItem *addItem(const std::string &item);
 
-  void addItem(CIMenuItem *item);
+  // add item allocated with new (box takes ownership)
+  virtual void addItem(CIMenuItem *item);
+
+  // add items for names/data (strings are moved into items)
+  void addItems(Names &&names);
+  void addItems(ItemDatas &&datas);
+
+  // add item for each line of file (item names reference file mapping)
+  bool addItemsFromFile(const std::string &filename);
+
+  // length of longest selectable item name
+  int maxItemLength() const { return maxItemLength_; }
 
   //---
 
+  // get/set checked state of item (by index in items)
+  bool isItemChecked(int i) const { return checked_.test(i); }
+  void setItemChecked(int i, bool b) { checked_.set(i, b); }
+
+  // set checked state of all selectable items
+  void setAllChecked(bool b);
+
+  // toggle checked state of all selectable items
+  void invertChecked();
+
+  // set checked state of items in box
+  void setItemsChecked(const Items &items, bool b);
+
+  // number of checked items
+  int numChecked() const { return checked_.count(); }
+
+  // index of first checked item at or after i (-1 if none)
+  int nextChecked(int i) const { return checked_.next(i); }
+
+  // create item of type T in box item arena and add it
+  template<typename T, typename... Args>
+  T *createItem(Args&&... args) {
+    T *item = newItem<T>(std::forward<Args>(args)...);
+
+    addItem(item);
+
+    return item;
+  }
+
+  //---
+
+ protected:
+  friend class CIMenuItem;
+
+  // construct item of type T in box item arena (not added)
+  template<typename T, typename... Args>
+  T *newItem(Args&&... args) {
+    void *p = arena_.allocate(sizeof(T), alignof(T));
+
+    T *item = new (p) T(std::forward<Args>(args)...);
+
+    item->pooled_ = true;
+
+    return item;
+  }
+
+  // reserve per item storage for n more items
+  void reserveItems(size_t n);
+
  protected:
-  BorderStyle borderStyle_ { BorderStyle::NONE }; // box border
-  bool        checkable_   { false };             // are items checkable
-  CIMenuBox*  parent_      { nullptr };           // parent box
-  Items       items_;                             // child items
-  mutable int numColumns_  { -1 };
+  typedef std::vector<std::unique_ptr<CIMenuFile>> Files;
+
+  BorderStyle      borderStyle_   { BorderStyle::NONE }; // box border
+  bool             checkable_     { false };             // are items checkable
+  CIMenuBox*       parent_        { nullptr };           // parent box
+  Items            items_;                               // child items
+  CIMenuArena      arena_;                               // storage for created items
+  CIMenuStringPool strings_;                             // storage for item strings
+  Files            files_;                               // mapped files for item names
+  CIMenuBitSet     checked_;                             // checked items (by index)
+  CIMenuBitSet     selectable_;                          // selectable items (by index)
+  int              maxItemLength_ { 0 };                 // longest selectable item name
+  mutable int      numColumns_    { -1 };
 };
 
 //---
@@ -71,8 +165,8 @@ class CIMenuItem {
  public:
   CIMenuItem() { }
 
-  explicit CIMenuItem(const std::string &name) :
-   name_(name) {
+  explicit CIMenuItem(const std::string &name) {
+    setName(name);
   }
 
   virtual ~CIMenuItem() { }
@@ -81,23 +175,35 @@ class CIMenuItem {
   void setBase(CIMenuBase *p) { base_ = p; }
 
   // get/set name
-  std::string getName() const { return name_; }
-  void setName(const std::string &name) { name_ = name; }
+  std::string getName() const { return std::string(name_); }
+  void setName(const std::string &name);
 
-  // get/set command
-  std::string getCommand() const { return (command_.size() ? command_ : name_); }
-  void setCommand(const std::string &command) { command_ = command; }
+  // name without copy (valid until name is changed or item is cleared)
+  std::string_view nameView() const { return name_; }
+
+  // set name to reference external storage (must outlive item)
+  void setNameRef(std::string_view name) { name_ = name; }
+
+  // get/set command (defaults to name)
+  std::string getCommand() const { return std::string(commandView()); }
+  void setCommand(const std::string &command);
+
+  // command without copy (valid until command is changed or item is cleared)
+  std::string_view commandView() const { return (command_.empty() ? name_ : command_); }
 
   // get/set is selectable
   bool isSelectable() const { return selectable_; }
-  void setSelectable(bool b) { selectable_ = b; }
+  void setSelectable(bool b);
+
+  // get/set is checked (state is held by box)
+  bool isChecked() const { return (box_ ? box_->isItemChecked(index_) : checked_); }
+  void setChecked(bool b);
 
-  // get/set is checled
-  bool isChecked() const { return checked_; }
-  void setChecked(bool b) { checked_ = b; }
+  // get index in box items (-1 if not in box)
+  int index() const { return index_; }
 
   // get/set column
-  void setColumn(int column) { column_ = column; }
+  void setColumn(int column);
   int getColumn() const { return column_; }
 
   // get/set row
@@ -105,26 +211,44 @@ class CIMenuItem {
   int getRow() const { return row_; }
 
   // get/set row span
-  void setColumnSpan(int columnSpan) { columnSpan_ = columnSpan; }
+  void setColumnSpan(int columnSpan);
   int getColumnSpan() const { return columnSpan_; }
 
   //---
 
-  // draw
+  // draw (at screen position set by base)
   virtual void draw();
 
   // handle press
   virtual void press();
 
+ private:
+  friend class CIMenuBox;
+
+  CIMenuItem(const CIMenuItem &) = delete;
+  CIMenuItem &operator=(const CIMenuItem &) = delete;
+
  protected:
-  CIMenuBase* base_       { nullptr };
-  std::string name_;
-  std::string command_;
-  bool        selectable_ { true };
-  bool        checked_    { false };
-  int         column_     { 1 };
-  int         row_        { -1 };
-  int         columnSpan_ { 1 };
+  // item owned strings (when not in box string pool)
+  struct Strings {
+    std::string name;
+    std::string command;
+  };
+
+  typedef std::unique_ptr<Strings> StringsP;
+
+  CIMenuBase*      base_       { nullptr };
+  CIMenuBox*       box_        { nullptr }; // containing box
+  int              index_      { -1 };      // index in box items
+  std::string_view name_;                   // name (pooled, owned or referenced)
+  std::string_view command_;                // command (empty for name)
+  StringsP         strings_;                // owned strings
+  bool             selectable_ { true };
+  bool             checked_    { false };   // checked state until added to box
+  int              column_     { 1 };
+  int              row_        { -1 };
+  int              columnSpan_ { 1 };
+  bool             pooled_     { false };   // allocated in box arena
 };
 
 //---
@@ -174,13 +298,44 @@ class CIMenuBase : public CIMenuBox {
   // add item to top box
   CIMenuItem *addItem(const std::string &item) override;
 
-  void addItem(CIMenuItem *item);
+  void addItem(CIMenuItem *item) override;
+
+  // remove all items
+  void clearItems() override;
+
+  //---
+
+  // read newline separated items from fd in background (added while menu is shown)
+  bool readItems(int fd);
+
+  // add items read since last call (returns true if any added)
+  bool addReadItems();
+
+  // is background read in progress
+  bool isReading() const;
+
+  //---
+
+  // load frecency history (initial cursor is placed on highest scoring item)
+  bool loadHistory(const std::string &filename);
+
+  // add current or checked commands to history file
+  bool recordHistory();
 
   //---
 
   virtual void initDrawItems();
   virtual void termDrawItems();
 
+  // assign item rows and build column row index
+  void updateLayout() const;
+
+  // force layout update (on next draw or lookup)
+  void invalidateLayout() { layoutValid_ = false; numColumns_ = -1; }
+
+  // force update of selectable rows of item column
+  void invalidateSelectable(CIMenuItem *item);
+
   void fixRow();
 
   //--
@@ -195,20 +350,46 @@ class CIMenuBase : public CIMenuBox {
 
   //---
 
+  // redraw after state change (cursor only change just moves cursor)
+  virtual void redraw();
+
   // draw items
   virtual void drawItems();
 
+  // item display changed (only item is redrawn if it is the current item)
+  void updateItem(CIMenuItem *item);
+
   // draw cursor
   virtual void drawCursor() const;
 
   //---
 
-  // get row/col character position
+  // frame cell grid (items draw into this)
+  CTermScreen &screen() const { return screen_; }
+
+  // frame output buffer (changed cells flushed once per drawItems)
+  CTermOutput &output() const { return output_; }
+
+  //---
+
+  // get row/col character position (row is relative to top of view)
   virtual int getRowPos(int row) const;
   virtual int getColPos(int col) const;
 
   //---
 
+  // get number of rows visible in view
+  int visibleRows() const;
+
+  // get/set first visible row of column
+  int  scrollRow(int col) const;
+  void setScrollRow(int col, int row);
+
+  // scroll current column so current row is visible (returns true if scrolled)
+  bool scrollToCursor();
+
+  //---
+
   // get/set current row/col
   int  currentRow() const;
   void setCurrentRow(int row);
@@ -227,6 +408,9 @@ class CIMenuBase : public CIMenuBox {
   // get item at row and column
   CIMenuItem *getItem(int row, int col) const;
 
+  // get item drawn at screen cell (1 based) in last frame and its row/column
+  CIMenuItem *getItemAt(int r, int c, int &row, int &col) const;
+
   //---
 
   // get maximum number of rows in all columns
@@ -240,9 +424,50 @@ class CIMenuBase : public CIMenuBox {
 
   //---
 
+  // get first selectable row at or after row in column (-1 if none)
+  int nextSelectableRow(int row, int col) const;
+
+  // get last selectable row at or before row in column (-1 if none)
+  int prevSelectableRow(int row, int col) const;
+
+  //---
+
+  // get/set filter mode (only items matching filter text are shown in single column)
+  bool isFiltering() const { return filtering_; }
+  void setFiltering(bool b);
+
+  // get/set filter text
+  const std::string &filterText() const { return filterText_; }
+  void setFilterText(const std::string &text);
+
+  // get items matching filter (best match first)
+  const Items &filterItems() const { return filterItems_; }
+
+  // get/set number of items at or above which filtering runs in background
+  int asyncFilterSize() const { return asyncFilterSize_; }
+  void setAsyncFilterSize(int n) { asyncFilterSize_ = n; }
+
+  //---
+
+  // get/set max redraws per second (0 for no limit)
+  int maxFrameRate() const;
+  void setMaxFrameRate(int fps);
+
+  // get/set mouse support (click selects or activates item, wheel moves cursor)
+  bool isMouse() const;
+  void setMouse(bool mouse);
+
+  //---
+
   // handle key press
   void keyPress(const CKeyEvent &event);
 
+  // handle mouse press
+  void mousePress(const CMouseEvent &event);
+
+  // handle idle (returns true if redraw needed)
+  bool idle();
+
  public:
   // display items and handle user input
   void mainLoop();
@@ -257,11 +482,46 @@ class CIMenuBase : public CIMenuBox {
   void runCommand(const std::string &cmd);
 
  private:
+  enum class UpdateType {
+    NONE,   // no change since last redraw
+    CURSOR, // only cursor moved
+    ITEM,   // only current item changed
+    ALL     // layout or item change
+  };
+
+  static UpdateType mergeUpdate(UpdateType update1, UpdateType update2);
+
+  void processKey(const CKeyEvent &event);
+
+  void processMouse(const CMouseEvent &event);
+
   void updateState();
 
+  void updateCursor();
+
+  void updateCurrentItem();
+
   void processChar(unsigned char c);
 
-  void drawItem(CIMenuItem *item) const;
+  void layoutItem(CIMenuItem *item) const;
+
+  bool checkKeyPress(CKeyType type);
+
+  bool filterKeyPress(const CKeyEvent &event, char c);
+
+  void applyFilter();
+
+  void startFilter();
+
+  bool updateFilter();
+
+  void addFilterItem(CIMenuItem *item);
+
+  void drawItem(CIMenuItem *item, int row, int col) const;
+
+  void drawFilterText() const;
+
+  void drawScrollIndicators() const;
 
   void drawBox(int r1, int c1, int r2, int c2) const;
   void drawChar(int row, int col, char c) const;
@@ -270,11 +530,95 @@ class CIMenuBase : public CIMenuBox {
   friend class CIMenuApp;
 
   typedef std::map<int,int> ColumnRow;
+  typedef std::vector<int>  Rows;
+
+  enum class SortStage {
+    NONE,    // no rows being sorted
+    COLLECT, // collect selectable rows
+    RUNS,    // sort short runs
+    MERGE,   // merge runs of width
+    FINAL    // merge into sorted rows
+  };
+
+  // merge sort of rows added to sorted index, split into steps run when idle
+  struct SortBuild {
+    SortStage stage   { SortStage::NONE };
+    Rows      rows;               // rows being sorted
+    Rows      merged;             // merge output
+    int       numRows { 0 };      // column rows in sort
+    int       width   { 0 };      // width of sorted runs
+    int       pos     { 0 };      // next row to collect/sort or start of merge
+    int       pos1    { 0 };      // merge input positions
+    int       pos2    { 0 };
+    int       outPos  { 0 };      // merge output position
+  };
+
+  // column layout
+  struct ColumnData {
+    Items     items;                  // items per row (null for spanned row)
+    Rows      nextSel;                // next selectable row at or after row (-1 none)
+    Rows      prevSel;                // previous selectable row at or before row (-1 none)
+    int       numUnresolved { 0 };    // number of trailing rows with no next selectable
+    bool      selValid      { true }; // next/prev tables are valid
+    Rows      sorted;                 // selectable rows sorted by name (type-ahead)
+    int       numSorted     { 0 };    // number of rows added to sorted
+    SortBuild sortBuild;              // idle sort of rows after numSorted
+  };
+
+  typedef std::vector<ColumnData> Columns;
+
+  void appendSelectable(ColumnData &column) const;
+  void updateSelectable(ColumnData &column) const;
+  void updateSelectable(ColumnData &column, int row) const;
+
+  void startSorted(ColumnData &column) const;
+
+  bool buildSorted(ColumnData &column, int n) const;
+
+  bool buildSortedStep() const;
+
+  bool typeAhead(char c);
+
+  int findPrefixRow(int col, const std::string &prefix, bool next) const;
+
+  void checkHistoryItem(CIMenuItem *item);
+
+  void applyHistoryCursor();
+
+  typedef std::unique_ptr<CIMenuReader>  ReaderP;
+  typedef std::unique_ptr<CIMenuFilter>  FilterP;
+  typedef std::unique_ptr<CIMenuHistory> HistoryP;
+  typedef std::chrono::steady_clock::time_point TimePoint;
 
   CIMenuApp*        app_           { nullptr };
+  ReaderP           reader_;
+  FilterP           filter_;
+  HistoryP          history_;
+  bool              historyCursor_ { false };       // place cursor from history
+  CIMenuItem*       historyItem_   { nullptr };     // best history item to place
+  double            historyScore_  { 0.0 };         // score of best history item
+  bool              filtering_     { false };
+  std::string       filterText_;
+  Items             filterItems_;
+  int               asyncFilterSize_ { 100000 };
+  bool              filterPending_ { false };       // background filter results due
+  bool              filterReset_   { false };       // reset cursor on next results
+  int               filterNumItems_ { 0 };          // items in background filter
   int               currentCol_    { 0 };
   ColumnRow         cursorColRow_;
+  ColumnRow         scrollColRow_;
   mutable ColumnRow currentColRow_;
+  UpdateType        update_        { UpdateType::ALL };
+  std::string       typeText_;                      // type-ahead search text
+  TimePoint         typeTime_;                      // time of last type-ahead key
+  mutable int       sortTimer_     { 0 };   // idle sorted index build timer
+  mutable int       cursorRPos_    { -1 };  // drawn cursor row position
+  mutable int       cursorCPos_    { -1 };  // drawn cursor col position
+  mutable Columns     columns_;             // per column layout (row index)
+  mutable int         maxRows_     { 0 };     // maximum rows in all columns
+  mutable bool        layoutValid_ { true };  // layout index matches items
+  mutable CTermScreen screen_;
+  mutable CTermOutput output_;
   int               screenRows_    { 80 };
   int               screenCols_    { 60 };
   int               xMargin_       { 1 };
@@ -295,13 +639,21 @@ class CIMenuApp : public CTermApp {
   }
 
   void redraw() override {
-    menu_->drawItems();
+    menu_->redraw();
   }
 
   void keyPress(const CKeyEvent &event) override {
     menu_->keyPress(event);
   }
 
+  void mousePress(const CMouseEvent &event) override {
+    menu_->mousePress(event);
+  }
+
+  bool idle() override {
+    return menu_->idle();
+  }
+
  private:
   CIMenuBase *menu_ { nullptr };
 };
@@ -0,0 +1,71 @@
+#ifndef CIMENU_ARENA_H
+#define CIMENU_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// block (bump) allocator for menu items
+//
+// memory is handed out sequentially from large blocks and only released
+// all at once by clear(). Objects placed in the arena must be destroyed
+// explicitly by the owner before clear().
+class CIMenuArena {
+ public:
+  CIMenuArena(size_t blockSize=256*1024) :
+   blockSize_(blockSize) {
+  }
+
+  CIMenuArena(const CIMenuArena &) = delete;
+  CIMenuArena &operator=(const CIMenuArena &) = delete;
+
+  //---
+
+  // allocate aligned memory
+  void *allocate(size_t size, size_t align) {
+    size_t pad = padding(align);
+
+    if (! block_ || pos_ + pad + size > size_) {
+      newBlock(size + align);
+
+      pad = padding(align);
+    }
+
+    void *p = block_ + pos_ + pad;
+
+    pos_ += pad + size;
+
+    bytes_ += size;
+
+    return p;
+  }
+
+  // release all memory
+  void clear();
+
+  //---
+
+  size_t numBlocks() const { return blocks_.size(); }
+  size_t numBytes () const { return bytes_; }
+
+ private:
+  size_t padding(size_t align) const {
+    return (align - reinterpret_cast<uintptr_t>(block_ + pos_) % align) % align;
+  }
+
+  void newBlock(size_t minSize);
+
+ private:
+  using Block  = std::unique_ptr<char[]>;
+  using Blocks = std::vector<Block>;
+
+  size_t blockSize_ { 0 };
+  Blocks blocks_;
+  char*  block_     { nullptr }; // current block
+  size_t size_      { 0 };       // current block size
+  size_t pos_       { 0 };       // current block used
+  size_t bytes_     { 0 };       // total bytes allocated
+};
+
+#endif
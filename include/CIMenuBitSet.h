@@ -0,0 +1,65 @@
+#ifndef CIMENU_BITSET_H
+#define CIMENU_BITSET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// growable packed bit set (one bit per menu item)
+//
+// bulk operations work a 64 bit word at a time
+class CIMenuBitSet {
+ public:
+  CIMenuBitSet() { }
+
+  //---
+
+  int size() const { return size_; }
+
+  // resize (new bits are clear)
+  void resize(int n);
+
+  // reserve space for n bits
+  void reserve(int n) { words_.reserve(size_t((n + 63) >> 6)); }
+
+  // remove all bits
+  void clear() { words_.clear(); size_ = 0; }
+
+  //---
+
+  bool test(int i) const {
+    return (words_[size_t(i >> 6)] >> (i & 63)) & 1;
+  }
+
+  void set(int i, bool b=true) {
+    Word bit = Word(1) << (i & 63);
+
+    if (b)
+      words_[size_t(i >> 6)] |= bit;
+    else
+      words_[size_t(i >> 6)] &= ~bit;
+  }
+
+  //---
+
+  // clear all bits
+  void reset();
+
+  // toggle bits set in mask (same size)
+  void flip(const CIMenuBitSet &mask);
+
+  // number of set bits
+  int count() const;
+
+  // index of first set bit at or after i (-1 if none)
+  int next(int i) const;
+
+ private:
+  using Word  = uint64_t;
+  using Words = std::vector<Word>;
+
+  Words words_;
+  int   size_ { 0 };
+};
+
+#endif
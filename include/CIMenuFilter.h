@@ -0,0 +1,164 @@
+#ifndef CIMENU_FILTER_H
+#define CIMENU_FILTER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+class CIMenuItem;
+class CIMenuThreadPool;
+
+// fuzzy (subsequence) filter of menu items
+//
+// items whose name contains the query characters in order (ignoring case) match
+// and are ranked by score (consecutive and word start matches score higher)
+//
+// matches are cached per query so a query which extends a previous one only
+// rescans the previous matches (and any items added since)
+//
+// filtering can also be run on a background thread (start) which is cancelled
+// by the next start and hands ranked (partial and final) results to the
+// caller via takeMatches. The thread is kept for later filters and start,
+// cancel and clearCache only post requests to it so they never wait for a
+// running scan or sort.
+class CIMenuFilter {
+ public:
+  typedef std::vector<CIMenuItem *> Items;
+
+ public:
+  CIMenuFilter();
+
+ ~CIMenuFilter();
+
+  CIMenuFilter(const CIMenuFilter &) = delete;
+  CIMenuFilter &operator=(const CIMenuFilter &) = delete;
+
+  // get/set number of items above which scoring is split over threads
+  int parallelSize() const { return parallelSize_; }
+  void setParallelSize(int n) { parallelSize_ = n; }
+
+  // get/set minimum time between partial results of background filter
+  int publishMSecs() const { return publishMSecs_; }
+  void setPublishMSecs(int msecs) { publishMSecs_ = msecs; }
+
+  //---
+
+  // get selectable items matching query (best first)
+  void filter(const Items &items, const std::string &query, Items &matches);
+
+  //---
+
+  // start background filter of items for query (cancels running filter)
+  void start(const Items &items, const std::string &query);
+
+  // cancel background filter (does not wait, results are discarded)
+  void cancel();
+
+  // cancel background filter and wait until it stops using items (before
+  // items are deleted, thread stops at next cancel check)
+  void stop();
+
+  // get latest ranked matches from background filter if changed since last call
+  // (done is set if they are the final matches)
+  bool takeMatches(Items &matches, bool &done);
+
+  // fd readable when background filter matches can be taken
+  int notifyFd() const { return notifyFds_[0]; }
+
+  //---
+
+  // discard cached matches (must be called if items are removed or reordered)
+  void clearCache();
+
+  // number of cached queries (waits for background filter)
+  int numCached();
+
+  // score name for query (-1 if no match)
+  static int score(std::string_view name, std::string_view query);
+
+ private:
+  struct Match {
+    int score { 0 };
+    int index { 0 }; // index in items
+
+    // higher score first, then original order
+    bool operator<(const Match &rhs) const {
+      return (score != rhs.score ? score > rhs.score : index < rhs.index);
+    }
+  };
+
+  typedef std::vector<Match>   Matches;
+  typedef std::vector<Matches> ShardMatches;
+
+  // cached matches for query in item order (items from numItems on have not
+  // been scored)
+  struct Level {
+    std::string query;
+    int         numItems { 0 };
+    Matches     matches;
+  };
+
+  typedef std::vector<Level> Levels;
+
+  typedef std::unique_ptr<CIMenuThreadPool> ThreadPoolP;
+  typedef std::condition_variable           Cond;
+
+  void workerLoop();
+
+  void waitIdle();
+
+  void run(const std::string &query);
+
+  bool updateLevels(const Items &items, const std::string &query, bool partial);
+
+  bool scoreChunks(const Items &items, const Match *candidates, int i1, int i2,
+                   const std::string &query, Matches &matches, bool partial);
+
+  bool rankMatches(const Items &items, const Matches &matches, Items &ranked);
+
+  void publish(Items &matches, bool done);
+
+  void clearNotify();
+
+  int numShards(int n);
+
+  void scoreMatches(const Items &items, const Match *candidates, int i1, int i2,
+                    const std::string &query, Matches &matches);
+
+  void scoreItems(const Items &items, const Match *candidates, int i1, int i2,
+                  const std::string &query, Matches &matches) const;
+
+  bool sortMatches(Matches &matches);
+
+ private:
+  int               parallelSize_ { 50000 };
+  int               publishMSecs_ { 50 };
+  ThreadPoolP       pool_;
+  ShardMatches      shardMatches_;
+  Matches           sorted_;
+  Levels            levels_;                  // cached matches per query
+  Items             items_;                   // items snapshot for background filter
+  std::thread       thread_;                  // background filter thread
+  std::atomic<bool> cancel_       { false };  // stop current background filter
+  std::mutex        mutex_;                   // lock for request and result
+  Cond              requestCond_;             // new request for thread
+  Cond              idleCond_;                // thread finished request
+  bool              running_      { false };  // thread is processing request
+  bool              quit_         { false };
+  bool              requestNew_   { false };  // request to filter
+  std::string       requestQuery_;
+  Items             requestItems_;            // items to add to snapshot
+  bool              requestClear_ { false };  // clear cache before request
+  int               numSent_      { 0 };      // number of items sent to thread
+  Items             result_;                  // latest background filter matches
+  bool              resultNew_    { false };
+  bool              resultDone_   { false };
+  int               notifyFds_[2] { -1, -1 }; // pipe to signal new result
+};
+
+#endif
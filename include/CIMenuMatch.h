@@ -0,0 +1,44 @@
+#ifndef CIMENU_MATCH_H
+#define CIMENU_MATCH_H
+
+#include <string_view>
+
+// case insensitive (ASCII) character, substring and subsequence matching
+//
+// uses SSE2 or AVX2 on x86 when supported by the CPU (chosen at runtime)
+// with a scalar fallback
+namespace CIMenuMatch {
+  enum class Impl {
+    SCALAR,
+    SSE2,
+    AVX2
+  };
+
+  // get/set implementation (set is clamped to best supported)
+  Impl impl();
+  void setImpl(Impl impl);
+
+  // best implementation supported by CPU
+  Impl bestImpl();
+
+  const char *implName(Impl impl);
+
+  //---
+
+  // ASCII lower case (no locale lookup) used by all matching so scalar and
+  // vector compares agree
+  inline char lowerChar(char c) {
+    return (c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c);
+  }
+
+  // find character at or after pos (npos if not found)
+  size_t findChar(std::string_view str, size_t pos, char c);
+
+  // does str contain sub
+  bool containsSubstr(std::string_view str, std::string_view sub);
+
+  // does str contain characters of seq in order
+  bool containsSubseq(std::string_view str, std::string_view seq);
+}
+
+#endif
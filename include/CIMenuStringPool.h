@@ -0,0 +1,38 @@
+#ifndef CIMENU_STRING_POOL_H
+#define CIMENU_STRING_POOL_H
+
+#include <CIMenuArena.h>
+
+#include <string_view>
+#include <unordered_set>
+
+// pooled storage for item strings
+//
+// characters are copied into large shared blocks and returned as views which
+// stay valid until clear(). Interned strings are stored once.
+class CIMenuStringPool {
+ public:
+  CIMenuStringPool() { }
+
+  CIMenuStringPool(const CIMenuStringPool &) = delete;
+  CIMenuStringPool &operator=(const CIMenuStringPool &) = delete;
+
+  // copy string into pool
+  std::string_view add(std::string_view str);
+
+  // copy string into pool if not already interned
+  std::string_view intern(std::string_view str);
+
+  // release all strings
+  void clear();
+
+  size_t numBytes() const { return chars_.numBytes(); }
+
+ private:
+  using Interned = std::unordered_set<std::string_view>;
+
+  CIMenuArena chars_;
+  Interned    interned_;
+};
+
+#endif
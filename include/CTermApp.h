@@ -2,21 +2,66 @@
 #define CTERM_APP_H
 
 #include <CEvent.h>
+#include <CTermInput.h>
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <functional>
+#include <map>
+#include <vector>
+
+// terminal application
+//
+// mainLoop blocks in poll until there is terminal input, a watched signal,
+// a registered fd is readable or a timer expires (no periodic wakeups)
+class CTermApp : private CTermInputHandler {
+ public:
+  // event handler (returns true if redraw needed)
+  typedef std::function<bool()> Proc;
 
-class CTermApp {
  public:
   CTermApp();
 
   virtual ~CTermApp();
 
+  // mouse press/release events (positions are 1 based cells)
   bool isMouse() const { return mouse_; }
-  void setMouse(bool mouse) { mouse_ = mouse; }
+  void setMouse(bool mouse);
 
   bool isAutoExit() const { return autoExit_; }
   void setAutoExit(bool exit) { autoExit_ = exit; }
 
+  // time to wait after escape for rest of escape sequence (msecs)
+  int escapeTimeout() const { return escapeMSecs_; }
+  void setEscapeTimeout(int msecs) { escapeMSecs_ = std::max(msecs, 0); }
+
+  // max redraws per second (0 for no limit)
+  int maxFrameRate() const { return maxFrameRate_; }
+  void setMaxFrameRate(int fps) { maxFrameRate_ = std::max(fps, 0); }
+
   void mainLoop();
 
+  //---
+
+  // cached window size in characters and pixels (0 if unknown), updated on
+  // SIGWINCH and from terminal size reports so reading it never waits on
+  // the terminal
+  int windowRows() const { return windowRows_; }
+  int windowCols() const { return windowCols_; }
+
+  int windowWidth () const { return windowWidth_; }
+  int windowHeight() const { return windowHeight_; }
+
+  // refresh window size from tty (char size it does not know is requested
+  // from terminal and updated when report is read by main loop)
+  void updateWindowSize();
+
+  // ask terminal for pixel size (for callers that need it when tty has none)
+  void requestPixelSize();
+
+  //---
+
   virtual void keyPress(const CKeyEvent &) { }
 
   virtual void mousePress  (const CMouseEvent &) { }
@@ -24,25 +69,111 @@ class CTermApp {
 
   virtual void redraw() { }
 
+  // called after each batch of events (return true to redraw)
+  virtual bool idle() { return false; }
+
+  //---
+
+  // call proc when fd is readable (proc must consume the data)
+  void addInputFd(int fd, const Proc &proc);
+  void removeInputFd(int fd);
+
+  // call proc after msecs (and every msecs if repeat), returns timer id
+  int addTimer(int msecs, const Proc &proc, bool repeat=false);
+  void removeTimer(int id);
+
+  // call proc (from main loop) when signal is received
+  bool addSignal(int sig, const Proc &proc);
+  void removeSignal(int sig);
+
+  //---
+
+  // terminal input fd (stdin or controlling terminal if stdin redirected)
+  int inputFd() const { return inputFd_; }
+
   void setDone(bool done) { done_ = done; }
 
   void runCommand(const std::string &cmd);
 
  private:
-  void processString(const std::string &str);
-  bool processStringChar(unsigned char c);
-  void processChar(unsigned char c);
+  int readInput();
+  void processInput(const char *data, size_t len);
+  void processChar(unsigned char c, CEventModifier modifiers=CMODIFIER_NONE);
+
+  // decoded input
+  void inputChar(unsigned char c) override;
+  void inputAltChar(unsigned char c) override;
+  void inputKey(CKeyType type, CEventModifier modifiers) override;
+  void inputMouse(int button, int col, int row, bool release) override;
+  void inputCSI(char marker, const int *params, int numParams, char final) override;
+
+  void writeMouseMode(bool enable);
 
   bool setRaw(int fd);
   bool resetRaw(int fd);
 
+  int timerTimeout() const;
+
+  bool processTimers();
+  bool processSignals();
+  bool processInputFd(int fd);
+
+  void updateDisplay();
+
+  static void signalHandler(int sig);
+
  private:
-  bool            mouse_     { false };
-  bool            autoExit_  { true };
-  bool            done_      { false };
-  bool            inEscape_  { false };
-  std::string     escapeString_;
-  struct termios *ios_       { nullptr };
+  typedef std::chrono::steady_clock::time_point TimePoint;
+
+  struct InputFd {
+    int  fd { -1 };
+    Proc proc;
+  };
+
+  struct Timer {
+    int       id     { 0 };
+    TimePoint time;            // next expiry
+    int       msecs  { 0 };
+    bool      repeat { false };
+    Proc      proc;
+  };
+
+  struct Signal {
+    Proc             proc;
+    struct sigaction oldAction; // restored on remove
+  };
+
+  typedef std::vector<InputFd>  InputFds;
+  typedef std::vector<Timer>    Timers;
+  typedef std::map<int, Signal> Signals;
+
+ private:
+  bool            mouse_        { false };
+  bool            autoExit_     { true };
+  bool            done_         { false };
+  bool            running_      { false };  // in main loop
+  CTermInput      input_;                   // input decoder
+  int             pressButton_  { 0 };      // last pressed mouse button
+  int             windowRows_   { 24 };     // window size (chars)
+  int             windowCols_   { 80 };
+  int             windowWidth_  { 0 };      // window size (pixels)
+  int             windowHeight_ { 0 };
+  CKeyEvent       keyEvent_;                // reused key event
+  std::string     text_;                    // reused key text
+  int             inputFd_      { -1 };
+  struct termios *ios_          { nullptr };
+  InputFds        inputFds_;                // registered fds
+  Timers          timers_;
+  int             timerId_      { 0 };      // last timer id
+  Signals         signals_;                 // watched signals
+  int             maxFrameRate_ { 0 };      // redraw rate limit
+  TimePoint       lastRedraw_;              // time of last redraw
+  int             redrawTimer_  { 0 };      // pending capped redraw timer
+  int             escapeMSecs_  { 50 };     // escape sequence timeout
+  int             escapeTimer_  { 0 };      // pending escape key timer
+  char            inputBuffer_[4096];       // terminal read buffer
+
+  static int      s_signalFds[2];           // signal self pipe
 };
 
 #endif
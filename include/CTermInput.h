@@ -0,0 +1,93 @@
+#ifndef CTERM_INPUT_H
+#define CTERM_INPUT_H
+
+#include <CEvent.h>
+
+#include <cstddef>
+
+// receiver of decoded terminal input
+class CTermInputHandler {
+ public:
+  virtual ~CTermInputHandler() { }
+
+  // plain byte (not part of an escape sequence)
+  virtual void inputChar(unsigned char c) = 0;
+
+  // byte prefixed by escape (alt modified)
+  virtual void inputAltChar(unsigned char c) = 0;
+
+  // cursor, editing or function key
+  virtual void inputKey(CKeyType type, CEventModifier modifiers) = 0;
+
+  // mouse report (xterm button code and 1 based cell) from SGR (1006) or
+  // legacy X10 report (X10 release does not say which button)
+  virtual void inputMouse(int button, int col, int row, bool release) = 0;
+
+  // other CSI sequence (marker is private parameter prefix '<', '=', '>', '?' or 0)
+  virtual void inputCSI(char marker, const int *params, int numParams, char final) {
+    (void) marker; (void) params; (void) numParams; (void) final;
+  }
+};
+
+//---
+
+// table driven VT input decoder
+//
+// each byte is decoded in constant time by a state/byte transition table
+// (ground, escape, CSI, SS3 and OSC/DCS string states) with numeric
+// parameters accumulated into a fixed array, so no input is buffered or
+// re-parsed and nothing is allocated
+class CTermInput {
+ public:
+  enum class State : unsigned char {
+    GROUND,
+    ESCAPE,
+    CSI,
+    SS3,
+    STRING,        // OSC, DCS, SOS, PM or APC (ignored)
+    STRING_ESCAPE, // escape in string (ESC \ ends string)
+    MOUSE          // three bytes of X10 mouse report
+  };
+
+  enum { MAX_PARAMS = 16 };
+
+ public:
+  CTermInput(CTermInputHandler *handler) :
+   handler_(handler) {
+  }
+
+  State state() const { return state_; }
+
+  // decode byte
+  void put(unsigned char c);
+
+  // decode bytes
+  void put(const char *data, size_t len) {
+    for (size_t i = 0; i < len; ++i)
+      put(static_cast<unsigned char>(data[i]));
+  }
+
+  // end of input burst (escape with nothing after it is the Escape key)
+  void flush();
+
+  // discard partial sequence
+  void reset() { state_ = State::GROUND; }
+
+ private:
+  void dispatchCSI(unsigned char c);
+  void dispatchSS3(unsigned char c);
+
+  CEventModifier paramModifiers(int i) const;
+
+ private:
+  CTermInputHandler* handler_      { nullptr };
+  State              state_        { State::GROUND };
+  int                params_[MAX_PARAMS];          // CSI parameters
+  int                numParams_    { 0 };
+  char               marker_       { 0 };           // CSI private marker
+  char               intermediate_ { 0 };           // CSI intermediate byte
+  unsigned char      mouse_[3];                     // X10 mouse report bytes
+  int                mouseLen_     { 0 };
+};
+
+#endif
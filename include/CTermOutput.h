@@ -0,0 +1,75 @@
+#ifndef CTERM_OUTPUT_H
+#define CTERM_OUTPUT_H
+
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+
+// buffered terminal output
+//
+// escape sequences and text for a frame are appended to a single buffer
+// which is written with one system call when the frame is flushed
+class CTermOutput {
+ public:
+  CTermOutput(int fd=1) :
+   fd_(fd) {
+  }
+
+  //---
+
+  int fd() const { return fd_; }
+  void setFd(int fd) { fd_ = fd; }
+
+  //---
+
+  // pending (unflushed) output
+  const std::string &buffer() const { return buffer_; }
+
+  bool isEmpty() const { return buffer_.empty(); }
+
+  void clear() { buffer_.clear(); }
+
+  //---
+
+  // append to frame
+  void write(const std::string &str) { buffer_ += str; }
+  void write(std::string_view str) { buffer_.append(str.data(), str.size()); }
+  void write(const char *str) { buffer_ += str; }
+  void write(char c) { buffer_ += c; }
+
+  // append cursor move (1 based row/col)
+  void moveTo(int row, int col);
+
+  // append graphic rendition
+  void setSGR(int n);
+
+  //---
+
+  // write pending output
+  bool flush();
+
+  //---
+
+  // stats for last flushed frame
+  size_t frameBytes() const { return frameBytes_; }
+  uint   frameWrites() const { return frameWrites_; }
+
+  // stats for all flushed frames
+  size_t totalBytes () const { return totalBytes_; }
+  uint   totalWrites() const { return totalWrites_; }
+  uint   numFrames  () const { return numFrames_; }
+
+ private:
+  void appendInt(int i);
+
+ private:
+  int         fd_          { 1 };
+  std::string buffer_;
+  size_t      frameBytes_  { 0 };
+  uint        frameWrites_ { 0 };
+  size_t      totalBytes_  { 0 };
+  uint        totalWrites_ { 0 };
+  uint        numFrames_   { 0 };
+};
+
+#endif
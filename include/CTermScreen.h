@@ -0,0 +1,106 @@
+#ifndef CTERM_SCREEN_H
+#define CTERM_SCREEN_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/types.h>
+
+class CTermOutput;
+
+// shadow cell grid for terminal drawing
+//
+// a frame is drawn into the back grid and render() writes only the cells
+// which differ from the previous (front) frame. Only rows written since the
+// last render are compared so small updates cost is independent of size.
+//
+// clear() starts a new frame, otherwise drawing updates the previous frame
+class CTermScreen {
+ public:
+  enum { MAX_CELL_BYTES = 7 };
+
+  // character cell holding UTF-8 of one character (and any combining marks
+  // which fit). A double width character uses a second cell of width 0.
+  struct Cell {
+    char          text[MAX_CELL_BYTES] { ' ' }; // UTF-8 bytes
+    unsigned char len   { 1 };                  // number of bytes
+    unsigned char width { 1 };                  // columns (0 for second half of wide char)
+    unsigned char sgr   { 0 };                  // graphic rendition (0 is normal)
+
+    std::string_view str() const { return std::string_view(text, len); }
+
+    bool operator==(const Cell &rhs) const {
+      return len == rhs.len && width == rhs.width && sgr == rhs.sgr && str() == rhs.str();
+    }
+
+    bool operator!=(const Cell &rhs) const { return ! operator==(rhs); }
+  };
+
+ public:
+  CTermScreen() { }
+
+  //---
+
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+
+  // set size (forces full repaint if changed)
+  void resize(int rows, int cols);
+
+  // force full repaint on next render
+  void invalidate() { valid_ = false; }
+
+  //---
+
+  // clear back grid for new frame
+  void clear();
+
+  // set draw position (1 based row/col)
+  void moveTo(int row, int col) { row_ = row; col_ = col; lastCell_ = nullptr; }
+
+  int row() const { return row_; }
+  int col() const { return col_; }
+
+  // set draw graphic rendition
+  void setSGR(int n) { sgr_ = static_cast<unsigned char>(n); }
+
+  // draw UTF-8 text at current position (clipped to screen, position
+  // advances by display width)
+  void write(char c);
+  void write(std::string_view str);
+  void write(const char *str);
+
+  // get cell in back grid (1 based row/col)
+  const Cell &cell(int row, int col) const;
+
+  //---
+
+  // write changed cells to output and make back grid current
+  void render(CTermOutput &output);
+
+ private:
+  void writeChar(const char *text, size_t len, int width);
+
+  Cell *backCell(int row, int col);
+
+  void setRowDirty(int row);
+
+ private:
+  using Cells = std::vector<Cell>;
+  using Rows  = std::vector<int>;
+  using Flags = std::vector<char>;
+
+  int           rows_     { 0 };
+  int           cols_     { 0 };
+  bool          valid_    { false };   // front grid matches terminal
+  Cells         front_;                // last rendered frame
+  Cells         back_;                 // frame being drawn
+  Flags         rowDirty_;             // per row written since last render
+  Rows          dirtyRows_;            // rows written since last render
+  int           row_      { 1 };
+  int           col_      { 1 };
+  unsigned char sgr_      { 0 };
+  Cell*         lastCell_ { nullptr }; // last written cell (for combining marks)
+};
+
+#endif
@@ -1,11 +1,51 @@
 #include <CIMenu.h>
+#include <CIMenuFile.h>
+#include <CIMenuFilter.h>
+#include <CIMenuHistory.h>
+#include <CIMenuReader.h>
 
-#include <COSRead.h>
-#include <COSTerm.h>
 #include <CFuncs.h>
-#include <CEscape.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+
+namespace {
+
+// rows collected or merged per idle step (about 1ms)
+const int s_sortStepRows = 32768;
+
+// length of runs sorted before merging
+const int s_sortRunRows = 64;
+
+// type-ahead order of rows (by name then row)
+bool rowLess(const CIMenuBase::Items &items, int r1, int r2)
+{
+  int cmp = items[size_t(r1)]->nameView().compare(items[size_t(r2)]->nameView());
+
+  return (cmp != 0 ? cmp < 0 : r1 < r2);
+}
+
+// merge sorted ranges [i1, e1) and [i2, e2) to out at k, stopping after n rows
+// so large merges can be split over calls (returns number of rows merged)
+int mergeRows(const CIMenuBase::Items &items,
+              const std::vector<int> &rows1, int &i1, int e1,
+              const std::vector<int> &rows2, int &i2, int e2,
+              std::vector<int> &out, int &k, int n)
+{
+  int m = 0;
+
+  for ( ; m < n && (i1 < e1 || i2 < e2); ++m) {
+    if (i2 >= e2 || (i1 < e1 && ! rowLess(items, rows2[size_t(i2)], rows1[size_t(i1)])))
+      out[size_t(k++)] = rows1[size_t(i1++)];
+    else
+      out[size_t(k++)] = rows2[size_t(i2++)];
+  }
+
+  return m;
+}
+
+}
 
 CIMenuBase::
 CIMenuBase()
@@ -20,6 +60,8 @@ CIMenuBase()
 CIMenuBase::
 ~CIMenuBase()
 {
+  reader_.reset();
+
   clearItems();
 
   delete app_;
@@ -29,18 +71,16 @@ void
 CIMenuBase::
 updateState()
 {
-  COSTerm::getCharSize(&screenRows_, &screenCols_);
+  // cached by app (no terminal query per frame)
+  screenRows_ = app_->windowRows();
+  screenCols_ = app_->windowCols();
 }
 
 CIMenuItem *
 CIMenuBase::
 addItem(const std::string &name)
 {
-  CIMenuItem *item = CIMenuBox::addItem(name);
-
-  item->setBase(this);
-
-  return item;
+  return CIMenuBox::addItem(name);
 }
 
 void
@@ -50,6 +90,209 @@ addItem(CIMenuItem *item)
   CIMenuBox::addItem(item);
 
   item->setBase(this);
+
+  // append to end of column(s) if current layout is valid
+  if      (isFiltering())
+    addFilterItem(item);
+  else if (layoutValid_)
+    layoutItem(item);
+
+  if (historyCursor_)
+    checkHistoryItem(item);
+}
+
+void
+CIMenuBase::
+clearItems()
+{
+  // background filter must not read deleted items
+  if (filter_) {
+    filter_->stop();
+
+    filter_->clearCache();
+  }
+
+  filterPending_ = false;
+
+  historyItem_  = nullptr;
+  historyScore_ = 0.0;
+
+  CIMenuBox::clearItems();
+
+  filterItems_.clear();
+
+  // empty layout (filter layout is rebuilt as it always has a filter column)
+  columns_.clear();
+
+  maxRows_ = 0;
+
+  if (isFiltering())
+    invalidateLayout();
+  else
+    layoutValid_ = true;
+}
+
+bool
+CIMenuBase::
+readItems(int fd)
+{
+  if (reader_)
+    app_->removeInputFd(reader_->notifyFd());
+
+  reader_ = std::make_unique<CIMenuReader>(fd);
+
+  if (! reader_->start()) {
+    reader_.reset();
+    return false;
+  }
+
+  // add items when main loop is woken by reader
+  app_->addInputFd(reader_->notifyFd(), [this]() { return addReadItems(); });
+
+  return true;
+}
+
+bool
+CIMenuBase::
+addReadItems()
+{
+  if (! reader_)
+    return false;
+
+  Names names;
+
+  if (! reader_->takeItems(names))
+    return false;
+
+  addItems(std::move(names));
+
+  // grow column to fit read items
+  if (maxItemLength() + 2 > columnWidth())
+    setColumnWidth(maxItemLength() + 2);
+
+  update_ = UpdateType::ALL;
+
+  return true;
+}
+
+bool
+CIMenuBase::
+isReading() const
+{
+  return (reader_ && ! reader_->isDone());
+}
+
+bool
+CIMenuBase::
+loadHistory(const std::string &filename)
+{
+  history_ = std::make_unique<CIMenuHistory>(filename);
+
+  // don't record to invalid file
+  if (! history_->open()) {
+    history_.reset();
+    return false;
+  }
+
+  // find best item (new items are checked as added until a key is pressed)
+  historyCursor_ = true;
+  historyItem_   = nullptr;
+  historyScore_  = 0.0;
+
+  for (auto *item : items())
+    checkHistoryItem(item);
+
+  return true;
+}
+
+bool
+CIMenuBase::
+recordHistory()
+{
+  if (! history_)
+    return false;
+
+  CIMenuHistory::Commands commands;
+
+  if (isCheckable())
+    commands = checkedCommands();
+  else if (getCurrentItem())
+    commands.push_back(currentCommand());
+
+  if (commands.empty())
+    return true;
+
+  return history_->record(commands);
+}
+
+void
+CIMenuBase::
+checkHistoryItem(CIMenuItem *item)
+{
+  if (! item->isSelectable())
+    return;
+
+  double score = history_->score(item->commandView());
+
+  if (score > historyScore_) {
+    historyItem_  = item;
+    historyScore_ = score;
+  }
+}
+
+void
+CIMenuBase::
+applyHistoryCursor()
+{
+  if (! historyItem_ || isFiltering())
+    return;
+
+  updateLayout();
+
+  setCurrentCol(historyItem_->getColumn() - 1);
+  setCurrentRow(historyItem_->getRow() - 1);
+
+  historyItem_ = nullptr;
+}
+
+bool
+CIMenuBase::
+idle()
+{
+  bool changed = addReadItems();
+
+  if (updateFilter())
+    changed = true;
+
+  return changed;
+}
+
+int
+CIMenuBase::
+maxFrameRate() const
+{
+  return app_->maxFrameRate();
+}
+
+void
+CIMenuBase::
+setMaxFrameRate(int fps)
+{
+  app_->setMaxFrameRate(fps);
+}
+
+bool
+CIMenuBase::
+isMouse() const
+{
+  return app_->isMouse();
+}
+
+void
+CIMenuBase::
+setMouse(bool mouse)
+{
+  app_->setMouse(mouse);
 }
 
 void
@@ -77,10 +320,10 @@ checkedCommands() const
 {
   std::vector<std::string> commands;
 
-  for (const auto &item : items()) {
-    if (item->isChecked())
-      commands.push_back(item->getCommand());
-  }
+  commands.reserve(size_t(numChecked()));
+
+  for (int i = nextChecked(0); i >= 0; i = nextChecked(i + 1))
+    commands.emplace_back(item(i)->commandView());
 
   return commands;
 }
@@ -90,11 +333,110 @@ CIMenuBase::
 runCommand(const std::string &cmd)
 {
   app_->runCommand(cmd);
+
+  // terminal contents no longer match last frame
+  screen_.invalidate();
 }
 
 void
 CIMenuBase::
 keyPress(const CKeyEvent &event)
+{
+  // keys may be applied in a burst before one redraw so combine update for
+  // this key with previous ones
+  auto update = update_;
+
+  processKey(event);
+
+  update_ = mergeUpdate(update, update_);
+}
+
+CIMenuBase::UpdateType
+CIMenuBase::
+mergeUpdate(UpdateType update1, UpdateType update2)
+{
+  if (update1 == UpdateType::NONE || update1 == update2)
+    return update2;
+
+  if (update2 == UpdateType::NONE)
+    return update1;
+
+  // different partial updates need full redraw
+  return UpdateType::ALL;
+}
+
+void
+CIMenuBase::
+mousePress(const CMouseEvent &event)
+{
+  // combine update for this press with previous ones (see keyPress)
+  auto update = update_;
+
+  processMouse(event);
+
+  update_ = mergeUpdate(update, update_);
+}
+
+void
+CIMenuBase::
+processMouse(const CMouseEvent &event)
+{
+  // assume only cursor moves (including no change)
+  update_ = UpdateType::CURSOR;
+
+  historyCursor_ = false;
+  historyItem_   = nullptr;
+
+  int button = int(event.getButton());
+
+  // wheel up/down (buttons 4/5) moves to previous/next row
+  if (button == 4 || button == 5) {
+    int row;
+
+    if (button == 4)
+      row = prevSelectableRow(currentRow() - 1, currentCol());
+    else
+      row = nextSelectableRow(currentRow() + 1, currentCol());
+
+    if (row >= 0)
+      setCurrentRow(row);
+
+    return;
+  }
+
+  if (button != 1)
+    return;
+
+  const auto &pos = event.getPosition();
+
+  int row, col;
+
+  auto *item = getItemAt(pos.y, pos.x, row, col);
+
+  if (! item || ! item->isSelectable())
+    return;
+
+  // click on current item activates it (accept or toggle check)
+  if (item == getCurrentItem()) {
+    if (isCheckable()) {
+      update_ = UpdateType::ALL;
+
+      item->press();
+    }
+    else
+      app_->setDone(true);
+
+    return;
+  }
+
+  // click on other item makes it current
+  setCurrentCol(col);
+  setCurrentRow(row);
+}
+
+void
+CIMenuBase::
+processKey(const CKeyEvent &event)
 {
   const std::string &text = event.getText();
 
@@ -103,28 +445,22 @@ keyPress(const CKeyEvent &event)
   if (text.size() == 1)
     c = text[0];
 
-  //---
-
-  // search for matching menu item if alphabetic
-  if (isalpha(c)) {
-    int pos = 0;
+  // assume full update unless only cursor moves
+  update_ = UpdateType::ALL;
 
-    for (const auto &item : items()) {
-      int col = item->getColumn() - 1;
+  // user now controls cursor
+  historyCursor_ = false;
+  historyItem_   = nullptr;
 
-      if (col != currentCol()) continue;
-
-      if (item->isSelectable()) {
-        std::string name = item->getName();
+  //---
 
-        if (name[0] == c) {
-          setCurrentRow(pos);
-          break;
-        }
-      }
+  // filter text edit
+  if (filterKeyPress(event, c))
+    return;
 
-      ++pos;
-    }
+  // search for item with typed prefix
+  if (typeAhead(c)) {
+    update_ = UpdateType::CURSOR;
 
     return;
   }
@@ -133,12 +469,18 @@ keyPress(const CKeyEvent &event)
 
   CKeyType type = event.getType();
 
+  // bulk check
+  if (isCheckable() && checkKeyPress(type))
+    return;
+
   // accept
   if      (type == CKEY_TYPE_LineFeed || type == CKEY_TYPE_Return) {
     app_->setDone(true);
   }
   // next column
   else if (type == CKEY_TYPE_Greater) {
+    update_ = UpdateType::CURSOR;
+
     if (currentCol() < int(getNumColumns()) - 1) {
       setCurrentCol(currentCol() + 1);
 
@@ -147,6 +489,8 @@ keyPress(const CKeyEvent &event)
   }
   // previous column
   else if (type == CKEY_TYPE_Less) {
+    update_ = UpdateType::CURSOR;
+
     if (currentCol() >= 1) {
       setCurrentCol(currentCol() - 1);
 
@@ -155,45 +499,65 @@ keyPress(const CKeyEvent &event)
   }
   // previous row
   else if (type == CKEY_TYPE_Up) {
-    int row = currentRow();
+    update_ = UpdateType::CURSOR;
+
+    int row = prevSelectableRow(currentRow() - 1, currentCol());
 
-    if (row > 0) {
-      int row1 = row - 1;
+    if (row >= 0)
+      setCurrentRow(row);
+  }
+  // next row
+  else if (type == CKEY_TYPE_Down) {
+    update_ = UpdateType::CURSOR;
 
-      while (row1 >= 0) {
-        CIMenuItem *item1 = getItem(row1);
+    int row = nextSelectableRow(currentRow() + 1, currentCol());
 
-        if (item1 && item1->isSelectable())
-          break;
+    if (row >= 0)
+      setCurrentRow(row);
+  }
+  // previous page
+  else if (type == CKEY_TYPE_Page_Up) {
+    update_ = UpdateType::CURSOR;
 
-        --row1;
-      }
+    int row = prevSelectableRow(std::max(currentRow() - visibleRows(), 0), currentCol());
 
-      if (row1 >= 0)
-        setCurrentRow(row1);
-    }
+    if (row < 0)
+      row = nextSelectableRow(0, currentCol());
+
+    if (row >= 0)
+      setCurrentRow(row);
   }
-  // next row
-  else if (type == CKEY_TYPE_Down) {
-    int row = currentRow();
+  // next page
+  else if (type == CKEY_TYPE_Page_Down) {
+    update_ = UpdateType::CURSOR;
 
     int nr = getNumRows();
 
-    if (row < nr - 1) {
-      int row1 = row + 1;
+    int row = nextSelectableRow(std::min(currentRow() + visibleRows(), nr - 1), currentCol());
+
+    if (row < 0)
+      row = prevSelectableRow(nr - 1, currentCol());
 
-      while (row1 < nr) {
-        CIMenuItem *item1 = getItem(row1);
+    if (row >= 0)
+      setCurrentRow(row);
+  }
+  // first row
+  else if (type == CKEY_TYPE_Home) {
+    update_ = UpdateType::CURSOR;
 
-        if (item1 && item1->isSelectable())
-          break;
+    int row = nextSelectableRow(0, currentCol());
 
-        ++row1;
-      }
+    if (row >= 0)
+      setCurrentRow(row);
+  }
+  // last row
+  else if (type == CKEY_TYPE_End) {
+    update_ = UpdateType::CURSOR;
 
-      if (row1 < nr)
-        setCurrentRow(row1);
-    }
+    int row = prevSelectableRow(int(getNumRows()) - 1, currentCol());
+
+    if (row >= 0)
+      setCurrentRow(row);
   }
   // enter
   else if (type == CKEY_TYPE_Right) {
@@ -212,106 +576,914 @@ keyPress(const CKeyEvent &event)
   }
 }
 
-uint
+// handle bulk check keys (ctrl-a all, ctrl-d none, ctrl-r invert,
+// ctrl-f filter matches)
+bool
 CIMenuBase::
-getNumColumns() const
+checkKeyPress(CKeyType type)
 {
-  if (numColumns_ > 0)
-    return numColumns_;
-
-  if (items().empty())
-    return 0;
-
-  numColumns_ = 1;
-
-  for (const auto &item : items()) {
-    numColumns_ = std::max(numColumns_, item->getColumn());
+  if      (type == CKEY_TYPE_SOH)
+    setAllChecked(true);
+  else if (type == CKEY_TYPE_EOT)
+    setAllChecked(false);
+  else if (type == CKEY_TYPE_DC2)
+    invertChecked();
+  else if (type == CKEY_TYPE_ACK) {
+    if (isFiltering())
+      setItemsChecked(filterItems_, true);
   }
+  else
+    return false;
 
-  return numColumns_;
+  return true;
 }
 
-void
+bool
 CIMenuBase::
-drawItems()
+filterKeyPress(const CKeyEvent &event, char c)
 {
-  updateState();
-
-  initDrawItems();
-
-  //---
+  if (! isFiltering()) {
+    // start filter
+    if (c == '/') {
+      setFiltering(true);
+      return true;
+    }
 
-  // clear screen
-  COSRead::write(1, CEscape::ED(2));
+    return false;
+  }
 
   //---
 
-  // draw box
-  if (borderStyle() != BorderStyle::NONE) {
-    int c1 = getColPos(0) - 3;
-    int c2 = getColPos(getNumColumns());
-    int r1 = getRowPos(0) - 1;
-    int r2 = getRowPos(getMaxRows());
+  CKeyType type = event.getType();
 
-    drawBox(r1, c1, r2, c2);
+  // end filter
+  if      (type == CKEY_TYPE_Escape) {
+    setFiltering(false);
   }
+  // remove last character
+  else if (type == CKEY_TYPE_BackSpace || type == CKEY_TYPE_DEL) {
+    if (filterText_ != "")
+      setFilterText(filterText_.substr(0, filterText_.size() - 1));
+  }
+  // toggle check of current match (space or tab)
+  else if (isCheckable() && (c == ' ' || type == CKEY_TYPE_TAB)) {
+    auto *item = getCurrentItem();
 
-  // draw items
-  currentColRow_.clear();
-
-  for (const auto &item : items())
-    drawItem(item);
-
-  //---
-
-  // draw cursor
-  drawCursor();
-
-  //---
+    if (item)
+      item->press();
+  }
+  // add character
+  else if (isprint(c)) {
+    setFilterText(filterText_ + c);
+  }
+  else
+    return false;
 
-  termDrawItems();
+  return true;
 }
 
 void
 CIMenuBase::
-initDrawItems()
+setFiltering(bool b)
 {
-  using ColumnRowCount = std::map<int,int>;
+  if (b == filtering_)
+    return;
 
-  ColumnRowCount columnRowCount;
+  auto *item = getCurrentItem();
 
-  for (const auto &item : items()) {
-    int col = item->getColumn();
-    int row = 1;
+  filtering_ = b;
 
-    for (int ic = 0; ic < item->getColumnSpan(); ++ic) {
-      auto p = columnRowCount.find(col + ic);
+  filterText_ = "";
 
-      if (p == columnRowCount.end())
-        p = columnRowCount.insert(p, ColumnRow::value_type(col + ic, 0));
+  scrollColRow_.clear();
 
-      ++(*p).second;
+  if (filtering_) {
+    if (! filter_) {
+      filter_ = std::make_unique<CIMenuFilter>();
 
-      if (ic == 0)
-        row = (*p).second;
+      // show background filter results when main loop is woken by filter
+      app_->addInputFd(filter_->notifyFd(), [this]() { return updateFilter(); });
     }
 
-    item->setRow(row);
+    filter_->clearCache();
+
+    setCurrentCol(0);
+
+    applyFilter();
   }
+  else {
+    filter_->cancel();
 
-  //---
+    filterPending_ = false;
 
-  // update current row
-  int nr = getNumRows();
+    filterItems_.clear();
 
-  int row = currentRow();
+    invalidateLayout();
+
+    updateLayout();
+
+    // keep selected item current
+    if (item) {
+      setCurrentCol(item->getColumn() - 1);
+      setCurrentRow(item->getRow() - 1);
+    }
+  }
+}
+
+void
+CIMenuBase::
+setFilterText(const std::string &text)
+{
+  filterText_ = text;
+
+  if (isFiltering())
+    applyFilter();
+}
+
+void
+CIMenuBase::
+applyFilter()
+{
+  // filter large item lists in background so typing is not blocked
+  if (int(items().size()) >= asyncFilterSize_) {
+    startFilter();
+
+    filterReset_ = true;
+
+    return;
+  }
+
+  filter_->filter(items(), filterText_, filterItems_);
+
+  filterPending_ = false;
+
+  invalidateLayout();
+
+  setCurrentRow(0);
+
+  setScrollRow(0, 0);
+}
+
+void
+CIMenuBase::
+startFilter()
+{
+  filter_->start(items(), filterText_);
+
+  filterPending_  = true;
+  filterNumItems_ = int(items().size());
+}
+
+// get results from background filter (returns true if changed)
+bool
+CIMenuBase::
+updateFilter()
+{
+  if (! filterPending_ || ! isFiltering())
+    return false;
+
+  bool done = false;
+
+  if (! filter_->takeMatches(filterItems_, done))
+    return false;
+
+  invalidateLayout();
+
+  // first results for new filter text
+  if (filterReset_) {
+    setCurrentRow(0);
+
+    setScrollRow(0, 0);
+
+    filterReset_ = false;
+  }
+
+  if (done) {
+    filterPending_ = false;
+
+    // filter items read since start
+    if (int(items().size()) > filterNumItems_)
+      startFilter();
+  }
+
+  update_ = UpdateType::ALL;
+
+  return true;
+}
+
+void
+CIMenuBase::
+addFilterItem(CIMenuItem *item)
+{
+  // added to background filter results when it completes
+  if (filterPending_)
+    return;
+
+  // new matches are added after ranked matches
+  if (! item->isSelectable() || CIMenuFilter::score(item->nameView(), filterText_) < 0)
+    return;
+
+  filterItems_.push_back(item);
+
+  // rebuild if no filter column
+  if (layoutValid_ && columns_.empty())
+    invalidateLayout();
+
+  if (layoutValid_) {
+    auto &column = columns_[0];
+
+    column.items.push_back(item);
+
+    maxRows_ = int(column.items.size());
+
+    if (column.selValid)
+      appendSelectable(column);
+  }
+}
+
+uint
+CIMenuBase::
+getNumColumns() const
+{
+  if (isFiltering())
+    return 1;
+
+  if (numColumns_ > 0)
+    return numColumns_;
+
+  if (items().empty())
+    return 0;
+
+  numColumns_ = 1;
+
+  for (const auto &item : items()) {
+    numColumns_ = std::max(numColumns_, item->getColumn());
+  }
+
+  return numColumns_;
+}
+
+void
+CIMenuBase::
+redraw()
+{
+  auto update = update_;
+
+  update_ = UpdateType::NONE;
+
+  // move to best history item found since last redraw
+  if (historyItem_) {
+    applyHistoryCursor();
+
+    update = UpdateType::ALL;
+  }
+
+  // cursor or current item only change needs previous frame at same screen size
+  if ((update == UpdateType::CURSOR || update == UpdateType::ITEM) && cursorRPos_ >= 0) {
+    int screenRows = screenRows_, screenCols = screenCols_;
+
+    updateState();
+
+    // full redraw if view scrolls
+    if (screenRows_ == screenRows && screenCols_ == screenCols && ! scrollToCursor()) {
+      if (update == UpdateType::ITEM)
+        updateCurrentItem();
+      else
+        updateCursor();
+
+      return;
+    }
+  }
+
+  drawItems();
+}
+
+void
+CIMenuBase::
+updateCursor()
+{
+  // erase old cursor and draw new one in previous frame
+  screen_.moveTo(cursorRPos_, cursorCPos_);
+
+  screen_.setSGR(0);
+  screen_.write(' ');
+
+  drawCursor();
+
+  screen_.render(output_);
+
+  output_.flush();
+}
+
+void
+CIMenuBase::
+updateCurrentItem()
+{
+  // redraw current item in previous frame
+  auto *item = getCurrentItem();
+
+  if (item) {
+    screen_.moveTo(getRowPos(currentRow() - scrollRow(currentCol())), getColPos(currentCol()));
+
+    item->draw();
+  }
+
+  screen_.render(output_);
+
+  output_.flush();
+}
+
+void
+CIMenuBase::
+updateItem(CIMenuItem *item)
+{
+  // item cell only update if it is the current item
+  if (item == getCurrentItem())
+    update_ = UpdateType::ITEM;
+}
+
+void
+CIMenuBase::
+drawItems()
+{
+  updateState();
+
+  initDrawItems();
+
+  //---
+
+  // start new frame
+  screen_.resize(screenRows_, screenCols_);
+
+  screen_.clear();
+
+  //---
+
+  // draw box
+  if (borderStyle() != BorderStyle::NONE) {
+    int c1 = getColPos(0) - 3;
+    int c2 = getColPos(getNumColumns());
+    int r1 = getRowPos(isFiltering() ? -1 : 0) - 1;
+    int r2 = getRowPos(std::min(int(getMaxRows()), visibleRows()));
+
+    drawBox(r1, c1, r2, c2);
+  }
+
+  // draw items in view
+  currentColRow_.clear();
+
+  int nv = visibleRows();
+
+  for (int col = 0; col < int(columns_.size()); ++col) {
+    const auto &columnItems = columns_[size_t(col)].items;
+
+    int top = scrollRow(col);
+    int nr  = int(columnItems.size());
+
+    for (int row = top; row < top + nv && row < nr; ++row) {
+      auto *item = columnItems[size_t(row)];
+
+      if (item)
+        drawItem(item, row, col);
+    }
+  }
+
+  drawScrollIndicators();
+
+  if (isFiltering())
+    drawFilterText();
+
+  //---
+
+  // draw cursor
+  drawCursor();
+
+  //---
+
+  termDrawItems();
+
+  //---
+
+  // write changes since last frame
+  screen_.render(output_);
+
+  output_.flush();
+}
+
+void
+CIMenuBase::
+initDrawItems()
+{
+  updateLayout();
+
+  //---
+
+  // update current row
+  int nr = getNumRows();
+
+  int row = currentRow();
 
   if      (row < 0)
     setCurrentRow(0);
   else if (row >= nr)
     setCurrentRow(nr - 1);
 
-  fixRow();
+  fixRow();
+
+  scrollToCursor();
+}
+
+void
+CIMenuBase::
+updateLayout() const
+{
+  if (layoutValid_)
+    return;
+
+  layoutValid_ = true;
+
+  //---
+
+  columns_.clear();
+
+  maxRows_ = 0;
+
+  // filter matches in single column
+  if (isFiltering()) {
+    columns_.resize(1);
+
+    auto &column = columns_[0];
+
+    column.items = filterItems_;
+
+    while (column.nextSel.size() < column.items.size())
+      appendSelectable(column);
+
+    maxRows_ = int(column.items.size());
+
+    return;
+  }
+
+  // assign each item the next row in its column(s)
+  for (const auto &item : items())
+    layoutItem(item);
+}
+
+void
+CIMenuBase::
+layoutItem(CIMenuItem *item) const
+{
+  int col = item->getColumn() - 1;
+  int row = 1;
+
+  if (col < 0) col = 0;
+
+  int ns = std::max(item->getColumnSpan(), 1);
+
+  if (col + ns > int(columns_.size()))
+    columns_.resize(size_t(col + ns));
+
+  for (int ic = 0; ic < ns; ++ic) {
+    auto &column = columns_[size_t(col + ic)];
+
+    // spanned columns have empty row
+    column.items.push_back(ic == 0 ? item : nullptr);
+
+    if (ic == 0)
+      row = int(column.items.size());
+
+    maxRows_ = std::max(maxRows_, int(column.items.size()));
+
+    if (column.selValid)
+      appendSelectable(column);
+
+    // keep type-ahead index sorted when idle so it is ready for first key
+    startSorted(column);
+  }
+
+  item->setRow(row);
+}
+
+void
+CIMenuBase::
+appendSelectable(ColumnData &column) const
+{
+  // add next row to selectable tables
+  int   row  = int(column.nextSel.size());
+  auto *item = column.items[size_t(row)];
+
+  bool selectable = (item && item->isSelectable());
+
+  int prev = (row > 0 ? column.prevSel.back() : -1);
+
+  column.prevSel.push_back(selectable ? row : prev);
+  column.nextSel.push_back(-1);
+
+  ++column.numUnresolved;
+
+  // resolve trailing rows (each row resolved once so amortized O(1))
+  if (selectable) {
+    for (int r = row - column.numUnresolved + 1; r <= row; ++r)
+      column.nextSel[size_t(r)] = row;
+
+    column.numUnresolved = 0;
+  }
+}
+
+void
+CIMenuBase::
+updateSelectable(ColumnData &column) const
+{
+  if (column.selValid)
+    return;
+
+  column.nextSel.clear();
+  column.prevSel.clear();
+
+  column.numUnresolved = 0;
+
+  while (column.nextSel.size() < column.items.size())
+    appendSelectable(column);
+
+  column.selValid = true;
+}
+
+void
+CIMenuBase::
+invalidateSelectable(CIMenuItem *item)
+{
+  // cached filter matches only contain selectable items (restart running
+  // background filter)
+  if (filter_) {
+    filter_->clearCache();
+
+    if (filterPending_)
+      startFilter();
+  }
+
+  if (! layoutValid_)
+    return;
+
+  // filter column is rebuilt from new matches
+  if (isFiltering()) {
+    if (! columns_.empty())
+      columns_[0].selValid = false;
+
+    return;
+  }
+
+  int col = item->getColumn() - 1;
+
+  if (col < 0 || col >= int(columns_.size()))
+    return;
+
+  auto &column = columns_[size_t(col)];
+
+  // type-ahead index is sorted again when idle
+  column.sorted.clear();
+
+  column.numSorted = 0;
+
+  column.sortBuild = SortBuild();
+
+  updateSelectable(column, item->getRow() - 1);
+}
+
+// update next/prev selectable tables for change of row, only rows between the
+// selectable rows either side of it change
+void
+CIMenuBase::
+updateSelectable(ColumnData &column, int row) const
+{
+  int n = int(column.nextSel.size());
+
+  // rows not in tables yet are added with current state
+  if (! column.selValid || row < 0 || row >= n)
+    return;
+
+  auto *item = column.items[size_t(row)];
+
+  bool selectable = (item && item->isSelectable());
+
+  int prev = (row > 0     ? column.prevSel[size_t(row - 1)] : -1);
+  int next = (row < n - 1 ? column.nextSel[size_t(row + 1)] : -1);
+
+  int nextRow = (selectable ? row : next);
+  int prevRow = (selectable ? row : prev);
+
+  for (int r = prev + 1; r <= row; ++r)
+    column.nextSel[size_t(r)] = nextRow;
+
+  int r2 = (next >= 0 ? next : n);
+
+  for (int r = row; r < r2; ++r)
+    column.prevSel[size_t(r)] = prevRow;
+
+  // trailing rows with no next selectable
+  if (next < 0)
+    column.numUnresolved = n - 1 - prevRow;
+}
+
+// start idle sort of rows not in sorted index
+void
+CIMenuBase::
+startSorted(ColumnData &column) const
+{
+  auto &build = column.sortBuild;
+
+  int nr = int(column.items.size());
+
+  if (build.stage != SortStage::NONE || column.numSorted >= nr)
+    return;
+
+  build = SortBuild();
+
+  build.stage   = SortStage::COLLECT;
+  build.numRows = nr;
+  build.pos     = column.numSorted;
+
+  // steps run between events until all columns are sorted
+  if (! sortTimer_)
+    sortTimer_ = app_->addTimer(0, [this]() { return buildSortedStep(); }, /*repeat*/true);
+}
+
+// sort up to about n rows of column (returns true when sort is done)
+bool
+CIMenuBase::
+buildSorted(ColumnData &column, int n) const
+{
+  auto &build = column.sortBuild;
+  auto &rows  = build.rows;
+
+  int nr = int(rows.size());
+
+  while (n > 0) {
+    if      (build.stage == SortStage::COLLECT) {
+      for ( ; build.pos < build.numRows && n > 0; ++build.pos, --n) {
+        auto *item = column.items[size_t(build.pos)];
+
+        if (item && item->isSelectable())
+          rows.push_back(build.pos);
+      }
+
+      if (build.pos < build.numRows)
+        break;
+
+      nr = int(rows.size());
+
+      build.stage = SortStage::RUNS;
+      build.pos   = 0;
+    }
+    else if (build.stage == SortStage::RUNS) {
+      for ( ; build.pos < nr && n > 0; build.pos += s_sortRunRows, n -= s_sortRunRows) {
+        int e = std::min(build.pos + s_sortRunRows, nr);
+
+        std::sort(rows.begin() + build.pos, rows.begin() + e, [&](int r1, int r2) {
+          return rowLess(column.items, r1, r2); });
+      }
+
+      if (build.pos < nr)
+        break;
+
+      build.merged.resize(size_t(nr));
+
+      build.stage = SortStage::MERGE;
+      build.width = s_sortRunRows;
+      build.pos   = 0;
+      build.pos1  = 0;
+      build.pos2  = std::min(s_sortRunRows, nr);
+    }
+    else if (build.stage == SortStage::MERGE) {
+      // all rows in one run
+      if (build.width >= nr) {
+        build.merged.resize(column.sorted.size() + size_t(nr));
+
+        build.stage  = SortStage::FINAL;
+        build.pos1   = 0;
+        build.pos2   = 0;
+        build.outPos = 0;
+
+        continue;
+      }
+
+      // merge next pair of runs
+      int e1 = std::min(build.pos + build.width, nr);
+      int e2 = std::min(build.pos + 2*build.width, nr);
+
+      n -= mergeRows(column.items, rows, build.pos1, e1, rows, build.pos2, e2,
+                     build.merged, build.outPos, n);
+
+      if (build.outPos < e2)
+        break;
+
+      build.pos  = e2;
+      build.pos1 = e2;
+      build.pos2 = std::min(e2 + build.width, nr);
+
+      // next pass on merged runs
+      if (build.pos >= nr) {
+        rows.swap(build.merged);
+
+        build.width *= 2;
+        build.pos    = 0;
+        build.pos1   = 0;
+        build.pos2   = std::min(build.width, nr);
+        build.outPos = 0;
+      }
+    }
+    else if (build.stage == SortStage::FINAL) {
+      n -= mergeRows(column.items, column.sorted, build.pos1, int(column.sorted.size()),
+                     rows, build.pos2, nr, build.merged, build.outPos, n);
+
+      if (build.outPos < int(build.merged.size()))
+        break;
+
+      column.sorted.swap(build.merged);
+
+      column.numSorted = build.numRows;
+
+      build = SortBuild();
+    }
+    else
+      break;
+  }
+
+  return (build.stage == SortStage::NONE);
+}
+
+// idle step of sorted index build (stops timer when all columns are sorted)
+bool
+CIMenuBase::
+buildSortedStep() const
+{
+  bool done = true;
+
+  for (auto &column : columns_) {
+    if (column.sortBuild.stage == SortStage::NONE)
+      continue;
+
+    // continue with rows added during sort
+    if (buildSorted(column, s_sortStepRows))
+      startSorted(column);
+
+    done = false;
+
+    break;
+  }
+
+  if (done) {
+    app_->removeTimer(sortTimer_);
+
+    sortTimer_ = 0;
+  }
+
+  // index does not change display
+  return false;
+}
+
+bool
+CIMenuBase::
+typeAhead(char c)
+{
+  // text times out after pause in typing
+  static const auto timeout = std::chrono::milliseconds(1000);
+
+  auto t = std::chrono::steady_clock::now();
+
+  if (typeText_ != "" && t - typeTime_ > timeout)
+    typeText_ = "";
+
+  // start with alphanumeric, continue with any printable (except column keys)
+  if (typeText_ == "") {
+    if (! isalnum(c))
+      return false;
+  }
+  else {
+    if (! isgraph(c) || c == '<' || c == '>')
+      return false;
+  }
+
+  typeTime_ = t;
+
+  // repeated single character cycles through matches
+  bool cycle = (typeText_.size() == 1 && typeText_[0] == c);
+
+  if (! cycle)
+    typeText_ += c;
+
+  int row = findPrefixRow(currentCol(), typeText_, cycle);
+
+  if (row >= 0)
+    setCurrentRow(row);
+
+  return true;
+}
+
+// first row with name starting with prefix (or next after current row), rows
+// in the sorted index are binary searched and rows added since are scanned
+int
+CIMenuBase::
+findPrefixRow(int col, const std::string &prefix, bool next) const
+{
+  updateLayout();
+
+  if (col < 0 || col >= int(columns_.size()))
+    return -1;
+
+  auto &column = columns_[size_t(col)];
+
+  // rows added by layout are sorted when idle (key press never waits for sort)
+  startSorted(column);
+
+  const auto &items  = column.items;
+  const auto &sorted = column.sorted;
+
+  auto isMatch = [&](int r) {
+    return (items[size_t(r)]->nameView().compare(0, prefix.size(), prefix) == 0);
+  };
+
+  // next match after current item (wrap to first)
+  int row = currentRow();
+
+  if (next && (row < 0 || row >= int(items.size()) || ! items[size_t(row)]))
+    next = false;
+
+  int first = -1, after = -1;
+
+  // first name >= prefix
+  auto p1 = std::lower_bound(sorted.begin(), sorted.end(), prefix,
+    [&](int r, const std::string &str) { return items[size_t(r)]->nameView() < str; });
+
+  if (p1 != sorted.end() && isMatch(*p1)) {
+    first = *p1;
+
+    if (next) {
+      auto p2 = std::upper_bound(p1, sorted.end(), row, [&](int r1, int r2) {
+        return rowLess(items, r1, r2); });
+
+      if (p2 != sorted.end() && isMatch(*p2))
+        after = *p2;
+    }
+  }
+
+  // rows not yet sorted
+  for (int r = column.numSorted; r < int(items.size()); ++r) {
+    auto *item = items[size_t(r)];
+
+    if (! item || ! item->isSelectable() || ! isMatch(r))
+      continue;
+
+    if (first < 0 || rowLess(items, r, first))
+      first = r;
+
+    if (next && rowLess(items, row, r) && (after < 0 || rowLess(items, r, after)))
+      after = r;
+  }
+
+  return (after >= 0 ? after : first);
+}
+
+int
+CIMenuBase::
+nextSelectableRow(int row, int col) const
+{
+  updateLayout();
+
+  if (col < 0 || col >= int(columns_.size()))
+    return -1;
+
+  auto &column = columns_[size_t(col)];
+
+  if (row < 0) row = 0;
+
+  if (row >= int(column.items.size()))
+    return -1;
+
+  updateSelectable(column);
+
+  return column.nextSel[size_t(row)];
+}
+
+int
+CIMenuBase::
+prevSelectableRow(int row, int col) const
+{
+  updateLayout();
+
+  if (col < 0 || col >= int(columns_.size()))
+    return -1;
+
+  auto &column = columns_[size_t(col)];
+
+  if (row >= int(column.items.size()))
+    row = int(column.items.size()) - 1;
+
+  if (row < 0)
+    return -1;
+
+  updateSelectable(column);
+
+  return column.prevSel[size_t(row)];
 }
 
 void
@@ -324,27 +1496,11 @@ void
 CIMenuBase::
 fixRow()
 {
-  int nr = getNumRows();
-
-  int row = currentRow();
-
-  while (row < nr) {
-    CIMenuItem *item1 = getItem(row);
-
-    if (item1 && item1->isSelectable())
-      break;
-
-    ++row;
-  }
-
-  while (row >= 0) {
-    CIMenuItem *item1 = getItem(row);
-
-    if (item1 && item1->isSelectable())
-      break;
+  // move to nearest selectable row (prefer next)
+  int row = nextSelectableRow(currentRow(), currentCol());
 
-    --row;
-  }
+  if (row < 0)
+    row = prevSelectableRow(int(getNumRows()) - 1, currentCol());
 
   if (row >= 0)
     setCurrentRow(row);
@@ -374,37 +1530,97 @@ void
 CIMenuBase::
 drawChar(int row, int col, char c) const
 {
-  COSRead::write(1, CEscape::CUP(row, col));
-  COSRead::write(1, c);
+  screen_.moveTo(row, col);
+  screen_.write(c);
 }
 
 void
 CIMenuBase::
-drawItem(CIMenuItem *item) const
+drawItem(CIMenuItem *item, int row, int col) const
 {
-  int col = item->getColumn() - 1;
-  int row = item->getRow   () - 1;
-
-  int rpos = getRowPos(row);
+  int rpos = getRowPos(row - scrollRow(col));
   int cpos = getColPos(col);
 
-  COSRead::write(1, CEscape::CUP(rpos, cpos));
+  screen_.moveTo(rpos, cpos);
 
   item->draw();
 
   currentColRow_[col] = ++row;
 }
 
+void
+CIMenuBase::
+drawFilterText() const
+{
+  // filter text on line above items
+  screen_.moveTo(getRowPos(-1), getColPos(0));
+
+  screen_.setSGR(33);
+  screen_.write('/');
+  screen_.write(filterText_);
+  screen_.setSGR(0);
+
+  screen_.write(" [" + std::to_string(filterItems_.size()) + "/" +
+                std::to_string(items().size()) + "]");
+}
+
+void
+CIMenuBase::
+drawScrollIndicators() const
+{
+  int nv = visibleRows();
+
+  // rows above and below view are box lines when there is a border, so
+  // draw in gap left of cursor column on first and last visible rows
+  bool border = (borderStyle() != BorderStyle::NONE);
+
+  int r1 = (border ? getRowPos(0)      : getRowPos(-1));
+  int r2 = (border ? getRowPos(nv - 1) : getRowPos(nv));
+
+  screen_.setSGR(32);
+
+  for (int col = 0; col < int(getNumColumns()); ++col) {
+    int top  = scrollRow(col);
+    int cpos = getColPos(col) - (border ? 2 : 1);
+
+    // more rows above
+    if (top > 0) {
+      screen_.moveTo(r1, cpos);
+      screen_.write('^');
+    }
+
+    // more rows below
+    if (top + nv < int(getNumRows(col))) {
+      screen_.moveTo(r2, cpos);
+      screen_.write('v');
+    }
+  }
+
+  screen_.setSGR(0);
+}
+
 void
 CIMenuBase::
 drawCursor() const
 {
-  int rpos = getRowPos(currentRow());
+  // no cursor until there is an item
+  if (! getCurrentItem()) {
+    cursorRPos_ = -1;
+    cursorCPos_ = -1;
+    return;
+  }
+
+  int rpos = getRowPos(currentRow() - scrollRow(currentCol()));
   int cpos = getColPos(currentCol()) - 1;
 
-  COSRead::write(1, CEscape::CUP(rpos, cpos));
+  cursorRPos_ = rpos;
+  cursorCPos_ = cpos;
 
-  COSRead::write(1, CEscape::SGR(32) + ">" + CEscape::SGR(0));
+  screen_.moveTo(rpos, cpos);
+
+  screen_.setSGR(32);
+  screen_.write('>');
+  screen_.setSGR(0);
 }
 
 int
@@ -416,6 +1632,10 @@ getRowPos(int row) const
   if (borderStyle() != BorderStyle::NONE)
     ++r;
 
+  // filter text line
+  if (isFiltering())
+    ++r;
+
   return r;
 }
 
@@ -449,6 +1669,69 @@ getColPos(int col) const
   return c;
 }
 
+int
+CIMenuBase::
+visibleRows() const
+{
+  // rows from first item row to bottom margin/border
+  int r1 = getRowPos(0);
+  int r2 = screenRows_ - yMargin();
+
+  if (borderStyle() != BorderStyle::NONE)
+    --r2;
+
+  return std::max(r2 - r1 + 1, 1);
+}
+
+int
+CIMenuBase::
+scrollRow(int col) const
+{
+  auto p = scrollColRow_.find(col);
+
+  if (p == scrollColRow_.end())
+    return 0;
+
+  return (*p).second;
+}
+
+void
+CIMenuBase::
+setScrollRow(int col, int row)
+{
+  scrollColRow_[col] = std::max(row, 0);
+}
+
+bool
+CIMenuBase::
+scrollToCursor()
+{
+  int col = currentCol();
+  int row = currentRow();
+  int top = scrollRow(col);
+  int nv  = visibleRows();
+
+  int top1 = top;
+
+  if      (row < top1)
+    top1 = row;
+  else if (row >= top1 + nv)
+    top1 = row - nv + 1;
+
+  // don't leave empty rows at bottom
+  int nr = getNumRows(col);
+
+  if (top1 > 0 && top1 + nv > nr)
+    top1 = std::max(nr - nv, 0);
+
+  if (top1 == top)
+    return false;
+
+  setScrollRow(col, top1);
+
+  return true;
+}
+
 CIMenuItem *
 CIMenuBase::
 getCurrentItem() const
@@ -467,27 +1750,54 @@ CIMenuItem *
 CIMenuBase::
 getItem(int row, int col) const
 {
-  for (const auto &item : items()) {
-    int row1 = item->getRow   () - 1;
-    int col1 = item->getColumn() - 1;
+  updateLayout();
 
-    if (row == row1 && col == col1)
-      return item;
-  }
+  if (col < 0 || col >= int(columns_.size()))
+    return nullptr;
+
+  const auto &columnItems = columns_[size_t(col)].items;
 
-  return nullptr;
+  if (row < 0 || row >= int(columnItems.size()))
+    return nullptr;
+
+  return columnItems[size_t(row)];
+}
+
+// constant time lookup (columns are fixed width and rows are indexed by layout)
+CIMenuItem *
+CIMenuBase::
+getItemAt(int r, int c, int &row, int &col) const
+{
+  // visible row
+  int vr = r - getRowPos(0);
+
+  if (vr < 0 || vr >= visibleRows())
+    return nullptr;
+
+  // column cell includes cursor before item
+  int c1 = getColPos(0) - 2;
+  int dc = getColPos(1) - getColPos(0);
+
+  if (c < c1)
+    return nullptr;
+
+  col = (c - c1)/dc;
+
+  if (col >= int(getNumColumns()))
+    return nullptr;
+
+  row = scrollRow(col) + vr;
+
+  return getItem(row, col);
 }
 
 uint
 CIMenuBase::
 getMaxRows() const
 {
-  int row = 0;
-
-  for (const auto &item : items())
-    row = std::max(row, item->getRow());
+  updateLayout();
 
-  return row;
+  return maxRows_;
 }
 
 uint
@@ -501,17 +1811,12 @@ uint
 CIMenuBase::
 getNumRows(int col) const
 {
-  int num = 0;
-
-  for (const auto &item : items()) {
-    int col1 = item->getColumn() - 1;
-
-    if (col != col1) continue;
+  updateLayout();
 
-    ++num;
-  }
+  if (col < 0 || col >= int(columns_.size()))
+    return 0;
 
-  return num;
+  return uint(columns_[size_t(col)].items.size());
 }
 
 int
@@ -538,66 +1843,344 @@ setCurrentRow(int row)
 
 //-------------
 
+CIMenuBox::
+CIMenuBox(CIMenuBox *parent) :
+ parent_(parent)
+{
+}
+
+CIMenuBox::
+~CIMenuBox()
+{
+  clearItems();
+}
+
 void
 CIMenuBox::
 clearItems()
 {
-  for (auto &item : items_)
-    delete item;
+  for (auto &item : items_) {
+    if (item->pooled_)
+      item->~CIMenuItem();
+    else
+      delete item;
+  }
 
   items_.clear();
+
+  arena_.clear();
+
+  strings_.clear();
+
+  files_.clear();
+
+  checked_   .clear();
+  selectable_.clear();
+
+  maxItemLength_ = 0;
+
+  numColumns_ = -1;
 }
 
 CIMenuItem *
 CIMenuBox::
 addItem(const std::string &name)
 {
-  auto *item = new CIMenuItem(name);
-
-  addItem(item);
-
-  return item;
+  return createItem<CIMenuItem>(name);
 }
 
 void
 CIMenuBox::
 addItem(CIMenuItem *item)
 {
+  // move item owned strings to pool
+  if (item->strings_) {
+    const auto &strings = *item->strings_;
+
+    if (item->name_.data() == strings.name.data())
+      item->name_ = strings_.add(item->name_);
+
+    if (item->command_.data() == strings.command.data())
+      item->command_ = strings_.intern(item->command_);
+
+    item->strings_.reset();
+  }
+
+  item->box_   = this;
+  item->index_ = int(items_.size());
+
   items_.push_back(item);
 
-  numColumns_ = -1;
+  checked_   .resize(int(items_.size()));
+  selectable_.resize(int(items_.size()));
+
+  if (item->isSelectable()) {
+    selectable_.set(item->index_);
+
+    // keep checked state set before add
+    if (item->checked_)
+      checked_.set(item->index_);
+  }
+
+  item->checked_ = false;
+
+  if (numColumns_ > 0)
+    numColumns_ = std::max(numColumns_, item->getColumn());
+
+  if (item->isSelectable())
+    maxItemLength_ = std::max(maxItemLength_, int(item->nameView().size()));
+}
+
+void
+CIMenuBox::
+addItems(Names &&names)
+{
+  // column count is maintained by addItem once known
+  if (items_.empty() && ! names.empty())
+    numColumns_ = 1;
+
+  reserveItems(names.size());
+
+  for (auto &name : names) {
+    auto *item = newItem<CIMenuItem>();
+
+    item->name_ = strings_.add(name);
+
+    addItem(item);
+  }
+
+  names.clear();
+}
+
+void
+CIMenuBox::
+addItems(ItemDatas &&datas)
+{
+  // column count is maintained by addItem once known
+  if (items_.empty() && ! datas.empty())
+    numColumns_ = 1;
+
+  reserveItems(datas.size());
+
+  for (auto &data : datas) {
+    // set item data before add so layout can be appended
+    auto *item = newItem<CIMenuItem>();
+
+    item->name_    = strings_.add(data.name);
+    item->command_ = strings_.intern(data.command);
+    item->column_  = std::max(data.column, 1);
+
+    addItem(item);
+  }
+
+  datas.clear();
+}
+
+bool
+CIMenuBox::
+addItemsFromFile(const std::string &filename)
+{
+  auto file = std::make_unique<CIMenuFile>(filename);
+
+  if (! file->open())
+    return false;
+
+  auto data = file->data();
+
+  files_.push_back(std::move(file));
+
+  //---
+
+  // column count is maintained by addItem once known
+  if (items_.empty() && ! data.empty())
+    numColumns_ = 1;
+
+  const char *begin = data.data();
+  const char *end   = begin + data.size();
+
+  // count lines so item storage is allocated once
+  size_t numLines = 0;
+
+  for (const char *p = begin; p < end; ++numLines) {
+    auto *nl = static_cast<const char *>(memchr(p, '\n', size_t(end - p)));
+
+    p = (nl ? nl + 1 : end);
+  }
+
+  reserveItems(numLines);
+
+  // add item per line (no copy of name)
+  for (const char *p = begin; p < end; ) {
+    auto *nl = static_cast<const char *>(memchr(p, '\n', size_t(end - p)));
+
+    if (! nl)
+      nl = end;
+
+    size_t len = size_t(nl - p);
+
+    // CRLF line end
+    if (len > 0 && p[len - 1] == '\r')
+      --len;
+
+    auto *item = newItem<CIMenuItem>();
+
+    item->setNameRef(std::string_view(p, len));
+
+    addItem(item);
+
+    p = nl + 1;
+  }
+
+  return true;
+}
+
+void
+CIMenuBox::
+reserveItems(size_t n)
+{
+  size_t size = items_.size() + n;
+
+  items_.reserve(size);
+
+  checked_   .reserve(int(size));
+  selectable_.reserve(int(size));
+}
+
+void
+CIMenuBox::
+setAllChecked(bool b)
+{
+  if (b)
+    checked_ = selectable_;
+  else
+    checked_.reset();
+}
+
+void
+CIMenuBox::
+invertChecked()
+{
+  checked_.flip(selectable_);
+}
+
+void
+CIMenuBox::
+setItemsChecked(const Items &items, bool b)
+{
+  for (const auto *item : items) {
+    if (item->box_ == this && item->isSelectable())
+      checked_.set(item->index_, b);
+  }
 }
 
 //-------------
 
 void
 CIMenuItem::
-draw()
+setName(const std::string &name)
 {
-  assert(base_);
+  if (! strings_)
+    strings_ = std::make_unique<Strings>();
+
+  strings_->name = name;
+
+  name_ = strings_->name;
+}
+
+void
+CIMenuItem::
+setCommand(const std::string &command)
+{
+  if (! strings_)
+    strings_ = std::make_unique<Strings>();
+
+  strings_->command = command;
+
+  command_ = strings_->command;
+}
+
+void
+CIMenuItem::
+setColumn(int column)
+{
+  column_ = column;
+
+  if (base_)
+    base_->invalidateLayout();
+}
 
-  int col = getColumn() - 1;
-  int row = getRow   () - 1;
+void
+CIMenuItem::
+setSelectable(bool b)
+{
+  if (b == selectable_)
+    return;
+
+  selectable_ = b;
+
+  // unselectable items are never checked
+  if (! b)
+    checked_ = false;
+
+  if (box_) {
+    box_->selectable_.set(index_, b);
+
+    if (! b)
+      box_->checked_.set(index_, false);
+  }
+
+  if (base_)
+    base_->invalidateSelectable(this);
+}
+
+void
+CIMenuItem::
+setChecked(bool b)
+{
+  if (b && ! selectable_)
+    return;
 
-  int rpos = base_->getRowPos(row);
-  int cpos = base_->getColPos(col);
+  if (box_)
+    box_->setItemChecked(index_, b);
+  else
+    checked_ = b;
+}
+
+void
+CIMenuItem::
+setColumnSpan(int columnSpan)
+{
+  columnSpan_ = columnSpan;
+
+  if (base_)
+    base_->invalidateLayout();
+}
+
+void
+CIMenuItem::
+draw()
+{
+  assert(base_);
 
-  COSRead::write(1, CEscape::CUP(rpos, cpos));
+  auto &screen = base_->screen();
 
   if (base_->isCheckable()) {
-    COSRead::write(1, CEscape::SGR(31) + " [");
+    screen.setSGR(31);
+    screen.write(" [");
 
     if (isChecked())
-      COSRead::write(1, "+");
+      screen.write('+');
     else
-      COSRead::write(1, " ");
+      screen.write(' ');
 
-    COSRead::write(1, "]" + CEscape::SGR(0));
+    screen.write(']');
+    screen.setSGR(0);
   }
 
-  std::string name = getName();
-
-  COSRead::write(1, " " + CEscape::SGR(31) + name + CEscape::SGR(0));
+  screen.write(' ');
+  screen.setSGR(31);
+  screen.write(name_);
+  screen.setSGR(0);
 }
 
 void
@@ -607,8 +2190,8 @@ press()
   if (base_ && base_->isCheckable()) {
     setChecked(! isChecked());
 
-    if (base_)
-      base_->drawItems();
+    // only item cell changes
+    base_->updateItem(this);
   }
 }
 
@@ -620,17 +2203,14 @@ draw()
 {
   assert(base_);
 
-  int col = getColumn() - 2;
-  int row = getRow   () - 1;
-
-  int rpos = base_->getRowPos(row);
-  int cpos = base_->getColPos(col);
-
-  COSRead::write(1, CEscape::CUP(rpos, cpos));
+  auto &screen = base_->screen();
 
-  std::string name = getName();
+  // text starts one column left of item column
+  screen.moveTo(screen.row(), base_->getColPos(getColumn() - 2));
 
-  COSRead::write(1, CEscape::SGR(31) + name + CEscape::SGR(0));
+  screen.setSGR(31);
+  screen.write(name_);
+  screen.setSGR(0);
 }
 
 void
@@ -0,0 +1,27 @@
+#include <CIMenuArena.h>
+
+#include <algorithm>
+
+void
+CIMenuArena::
+clear()
+{
+  blocks_.clear();
+
+  block_ = nullptr;
+  size_  = 0;
+  pos_   = 0;
+  bytes_ = 0;
+}
+
+void
+CIMenuArena::
+newBlock(size_t minSize)
+{
+  size_ = std::max(blockSize_, minSize);
+
+  blocks_.emplace_back(new char [size_]);
+
+  block_ = blocks_.back().get();
+  pos_   = 0;
+}
@@ -0,0 +1,73 @@
+#include <CIMenuBitSet.h>
+
+#include <algorithm>
+
+void
+CIMenuBitSet::
+resize(int n)
+{
+  size_t nw = size_t((n + 63) >> 6);
+
+  // clear bits past new size in last word so they are not counted if regrown
+  if (n < size_ && (n & 63) && nw > 0)
+    words_[nw - 1] &= (Word(1) << (n & 63)) - 1;
+
+  words_.resize(nw, 0);
+
+  size_ = n;
+}
+
+void
+CIMenuBitSet::
+reset()
+{
+  std::fill(words_.begin(), words_.end(), Word(0));
+}
+
+void
+CIMenuBitSet::
+flip(const CIMenuBitSet &mask)
+{
+  size_t nw = std::min(words_.size(), mask.words_.size());
+
+  for (size_t i = 0; i < nw; ++i)
+    words_[i] ^= mask.words_[i];
+}
+
+int
+CIMenuBitSet::
+count() const
+{
+  int n = 0;
+
+  for (const auto &word : words_)
+    n += __builtin_popcountll(word);
+
+  return n;
+}
+
+int
+CIMenuBitSet::
+next(int i) const
+{
+  if (i < 0)
+    i = 0;
+
+  if (i >= size_)
+    return -1;
+
+  size_t wi = size_t(i >> 6);
+
+  // skip bits before i in first word
+  Word word = words_[wi] & (~Word(0) << (i & 63));
+
+  for (;;) {
+    if (word)
+      return int(wi*64) + __builtin_ctzll(word);
+
+    if (++wi >= words_.size())
+      return -1;
+
+    word = words_[wi];
+  }
+}
@@ -0,0 +1,58 @@
+#include <CIMenuFile.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+CIMenuFile::
+CIMenuFile(const std::string &filename) :
+ filename_(filename)
+{
+}
+
+CIMenuFile::
+~CIMenuFile()
+{
+  if (data_)
+    ::munmap(const_cast<char *>(data_), size_);
+}
+
+bool
+CIMenuFile::
+open()
+{
+  int fd = ::open(filename_.c_str(), O_RDONLY);
+
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+
+  if (::fstat(fd, &st) < 0) {
+    ::close(fd);
+    return false;
+  }
+
+  // empty file has nothing to map
+  if (st.st_size == 0) {
+    ::close(fd);
+    return true;
+  }
+
+  void *p = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+  // mapping stays valid after close
+  ::close(fd);
+
+  if (p == MAP_FAILED)
+    return false;
+
+  data_ = static_cast<const char *>(p);
+  size_ = size_t(st.st_size);
+
+  // read once from start to end
+  ::madvise(p, size_, MADV_SEQUENTIAL);
+
+  return true;
+}
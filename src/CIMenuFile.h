@@ -0,0 +1,31 @@
+#ifndef CIMENU_FILE_H
+#define CIMENU_FILE_H
+
+#include <string>
+#include <string_view>
+
+// read only memory mapped file
+class CIMenuFile {
+ public:
+  CIMenuFile(const std::string &filename);
+
+ ~CIMenuFile();
+
+  CIMenuFile(const CIMenuFile &) = delete;
+  CIMenuFile &operator=(const CIMenuFile &) = delete;
+
+  // map file (returns false on error)
+  bool open();
+
+  const std::string &filename() const { return filename_; }
+
+  // mapped data
+  std::string_view data() const { return std::string_view(data_, size_); }
+
+ private:
+  std::string filename_;
+  const char* data_     { nullptr };
+  size_t      size_     { 0 };
+};
+
+#endif
@@ -0,0 +1,609 @@
+#include <CIMenuFilter.h>
+#include <CIMenuMatch.h>
+#include <CIMenuThreadPool.h>
+#include <CIMenu.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// same case folding as vector matching
+using CIMenuMatch::lowerChar;
+
+inline bool isWordStart(std::string_view name, size_t i) {
+  if (i == 0) return true;
+
+  char c = name[i - 1];
+
+  return (c == ' ' || c == '/' || c == '-' || c == '_' || c == '.' || c == ':');
+}
+
+}
+
+//---
+
+CIMenuFilter::
+CIMenuFilter()
+{
+  if (::pipe2(notifyFds_, O_NONBLOCK | O_CLOEXEC) < 0)
+    notifyFds_[0] = notifyFds_[1] = -1;
+}
+
+CIMenuFilter::
+~CIMenuFilter()
+{
+  if (thread_.joinable()) {
+    {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    quit_   = true;
+    cancel_ = true;
+    }
+
+    requestCond_.notify_one();
+
+    thread_.join();
+  }
+
+  for (auto &fd : notifyFds_) {
+    if (fd >= 0)
+      ::close(fd);
+  }
+}
+
+void
+CIMenuFilter::
+filter(const Items &items, const std::string &query, Items &matches)
+{
+  // cache is shared with background filter
+  cancel();
+
+  waitIdle();
+
+  matches.clear();
+
+  // empty query matches all selectable items (not cached)
+  if (query.empty()) {
+    levels_.clear();
+
+    for (auto *item : items) {
+      if (item->isSelectable())
+        matches.push_back(item);
+    }
+
+    return;
+  }
+
+  (void) updateLevels(items, query, /*partial*/false);
+
+  (void) rankMatches(items, levels_.back().matches, matches);
+}
+
+void
+CIMenuFilter::
+start(const Items &items, const std::string &query)
+{
+  // items added since last request for snapshot (items are only appended
+  // between cache clears)
+  Items newItems;
+
+  if (size_t(numSent_) < items.size())
+    newItems.assign(items.begin() + numSent_, items.end());
+
+  numSent_ = int(items.size());
+
+  {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (requestItems_.empty())
+    requestItems_.swap(newItems);
+  else
+    requestItems_.insert(requestItems_.end(), newItems.begin(), newItems.end());
+
+  requestQuery_ = query;
+  requestNew_   = true;
+
+  // stop running filter and drop its untaken result
+  cancel_ = true;
+
+  resultNew_ = false;
+
+  clearNotify();
+  }
+
+  if (! thread_.joinable())
+    thread_ = std::thread(&CIMenuFilter::workerLoop, this);
+
+  requestCond_.notify_one();
+}
+
+void
+CIMenuFilter::
+cancel()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  requestNew_ = false;
+
+  cancel_ = true;
+
+  // drop untaken result
+  resultNew_ = false;
+
+  clearNotify();
+}
+
+void
+CIMenuFilter::
+stop()
+{
+  cancel();
+
+  waitIdle();
+}
+
+bool
+CIMenuFilter::
+takeMatches(Items &matches, bool &done)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (! resultNew_)
+    return false;
+
+  matches.swap(result_);
+
+  done = resultDone_;
+
+  resultNew_ = false;
+
+  clearNotify();
+
+  return true;
+}
+
+void
+CIMenuFilter::
+clearCache()
+{
+  cancel();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // thread clears cache and snapshot before next request
+  requestClear_ = true;
+
+  requestItems_.clear();
+
+  numSent_ = 0;
+}
+
+int
+CIMenuFilter::
+numCached()
+{
+  waitIdle();
+
+  return int(levels_.size());
+}
+
+// background filter thread (runs latest request)
+void
+CIMenuFilter::
+workerLoop()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  for (;;) {
+    running_ = false;
+
+    idleCond_.notify_all();
+
+    requestCond_.wait(lock, [this]() { return requestNew_ || quit_; });
+
+    if (quit_)
+      break;
+
+    running_ = true;
+
+    if (requestClear_) {
+      levels_.clear();
+      items_ .clear();
+
+      requestClear_ = false;
+    }
+
+    Items newItems;
+
+    newItems.swap(requestItems_);
+
+    std::string query = std::move(requestQuery_);
+
+    requestNew_ = false;
+
+    cancel_ = false;
+
+    lock.unlock();
+
+    items_.insert(items_.end(), newItems.begin(), newItems.end());
+
+    run(query);
+
+    lock.lock();
+  }
+}
+
+// wait until thread has no running or posted request so cache can be used
+// by caller (thread may not have woken for a posted request yet)
+void
+CIMenuFilter::
+waitIdle()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  idleCond_.wait(lock, [this]() { return ! running_ && ! requestNew_; });
+
+  if (requestClear_) {
+    levels_.clear();
+    items_ .clear();
+
+    requestClear_ = false;
+  }
+
+  // no running filter to stop
+  cancel_ = false;
+}
+
+// background filter of item snapshot
+void
+CIMenuFilter::
+run(const std::string &query)
+{
+  Items matches;
+
+  if (query.empty()) {
+    levels_.clear();
+
+    for (size_t i = 0; i < items_.size(); ++i) {
+      // check for cancel of background filter
+      if ((i & 0x3ff) == 0 && cancel_)
+        return;
+
+      if (items_[i]->isSelectable())
+        matches.push_back(items_[i]);
+    }
+  }
+  else {
+    if (! updateLevels(items_, query, /*partial*/true))
+      return;
+
+    if (! rankMatches(items_, levels_.back().matches, matches))
+      return;
+  }
+
+  publish(matches, /*done*/true);
+}
+
+// update cached matches for query (returns false if cancelled)
+bool
+CIMenuFilter::
+updateLevels(const Items &items, const std::string &query, bool partial)
+{
+  int n = int(items.size());
+
+  // drop cached queries which are not a prefix of new query
+  while (! levels_.empty() && query.compare(0, levels_.back().query.size(),
+                                            levels_.back().query) != 0)
+    levels_.pop_back();
+
+  if (levels_.empty() || levels_.back().query != query) {
+    Level level;
+
+    level.query = query;
+
+    // only previous matches can match extended query
+    if (! levels_.empty()) {
+      const auto &prev = levels_.back();
+
+      level.numItems = prev.numItems;
+
+      if (! scoreChunks(items, prev.matches.data(), 0, int(prev.matches.size()),
+                        query, level.matches, partial))
+        return false;
+    }
+
+    levels_.push_back(std::move(level));
+  }
+
+  auto &level = levels_.back();
+
+  // score items added since query was cached
+  if (level.numItems < n) {
+    auto numMatches = level.matches.size();
+
+    if (! scoreChunks(items, nullptr, level.numItems, n, query, level.matches, partial)) {
+      level.matches.resize(numMatches);
+      return false;
+    }
+
+    level.numItems = n;
+  }
+
+  return true;
+}
+
+// score range [i1, i2) in chunks so a background filter can be cancelled and
+// show partial results
+bool
+CIMenuFilter::
+scoreChunks(const Items &items, const Match *candidates, int i1, int i2,
+            const std::string &query, Matches &matches, bool partial)
+{
+  static const int chunkSize = 256*1024;
+
+  using Clock = std::chrono::steady_clock;
+
+  auto publishTime = Clock::now();
+
+  for (int j1 = i1; j1 < i2; j1 += chunkSize) {
+    int j2 = std::min(j1 + chunkSize, i2);
+
+    scoreMatches(items, candidates, j1, j2, query, matches);
+
+    if (cancel_)
+      return false;
+
+    // show ranked matches so far if scan is slow
+    if (partial && j2 < i2) {
+      auto t = Clock::now();
+
+      if (t - publishTime >= std::chrono::milliseconds(publishMSecs_)) {
+        Items partialMatches;
+
+        if (! rankMatches(items, matches, partialMatches))
+          return false;
+
+        publish(partialMatches, /*done*/false);
+
+        publishTime = Clock::now();
+      }
+    }
+  }
+
+  return true;
+}
+
+// ranked items for matches (returns false if cancelled)
+bool
+CIMenuFilter::
+rankMatches(const Items &items, const Matches &matches, Items &ranked)
+{
+  // rank copy of matches (cached matches stay in item order for rescans)
+  sorted_ = matches;
+
+  if (! sortMatches(sorted_))
+    return false;
+
+  ranked.clear();
+
+  ranked.reserve(sorted_.size());
+
+  for (const auto &match : sorted_)
+    ranked.push_back(items[size_t(match.index)]);
+
+  return true;
+}
+
+void
+CIMenuFilter::
+publish(Items &matches, bool done)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // result of cancelled filter is dropped
+  if (cancel_)
+    return;
+
+  result_.swap(matches);
+
+  // wake caller for first untaken result
+  if (! resultNew_ && notifyFds_[1] >= 0)
+    (void) ::write(notifyFds_[1], "x", 1);
+
+  resultNew_  = true;
+  resultDone_ = done;
+}
+
+void
+CIMenuFilter::
+clearNotify()
+{
+  char buffer[16];
+
+  if (notifyFds_[0] >= 0) {
+    while (::read(notifyFds_[0], buffer, sizeof(buffer)) > 0)
+      ;
+  }
+}
+
+int
+CIMenuFilter::
+numShards(int n)
+{
+  if (n < parallelSize_)
+    return 1;
+
+  if (! pool_)
+    pool_ = std::make_unique<CIMenuThreadPool>();
+
+  return pool_->numThreads();
+}
+
+// append matches for candidates (or items if no candidates) in range [i1, i2)
+// in item order
+void
+CIMenuFilter::
+scoreMatches(const Items &items, const Match *candidates, int i1, int i2,
+             const std::string &query, Matches &matches)
+{
+  int n = i2 - i1;
+
+  if (n <= 0)
+    return;
+
+  // split large item lists into shards scored in parallel
+  int ns = numShards(n);
+
+  if (ns == 1) {
+    scoreItems(items, candidates, i1, i2, query, matches);
+    return;
+  }
+
+  shardMatches_.resize(size_t(ns));
+
+  pool_->run(ns, [&](int i) {
+    int j1 = i1 + int((long(n)* i     )/ns);
+    int j2 = i1 + int((long(n)*(i + 1))/ns);
+
+    auto &shardMatches = shardMatches_[size_t(i)];
+
+    shardMatches.clear();
+
+    scoreItems(items, candidates, j1, j2, query, shardMatches);
+  });
+
+  for (auto &shardMatches : shardMatches_) {
+    matches.insert(matches.end(), shardMatches.begin(), shardMatches.end());
+
+    shardMatches.clear();
+  }
+}
+
+// sort matches best first (large lists are sorted in parallel shards and
+// merged, returns false if cancelled)
+bool
+CIMenuFilter::
+sortMatches(Matches &matches)
+{
+  int n  = int(matches.size());
+  int ns = numShards(n);
+
+  if (ns == 1) {
+    std::sort(matches.begin(), matches.end());
+    return true;
+  }
+
+  auto shardBegin = [&](int i) {
+    return matches.begin() + (long(n)*i)/ns;
+  };
+
+  pool_->run(ns, [&](int i) {
+    if (! cancel_)
+      std::sort(shardBegin(i), shardBegin(i + 1));
+  });
+
+  for (int i = 1; i < ns; ++i) {
+    if (cancel_)
+      return false;
+
+    std::inplace_merge(matches.begin(), shardBegin(i), shardBegin(i + 1));
+  }
+
+  return true;
+}
+
+void
+CIMenuFilter::
+scoreItems(const Items &items, const Match *candidates, int i1, int i2,
+           const std::string &query, Matches &matches) const
+{
+  for (int i = i1; i < i2; ++i) {
+    // check for cancel of background filter
+    if ((i & 0x3ff) == 0 && cancel_)
+      break;
+
+    int ind = (candidates ? candidates[i].index : i);
+
+    auto *item = items[size_t(ind)];
+
+    if (! item->isSelectable())
+      continue;
+
+    int s = score(item->nameView(), query);
+
+    if (s >= 0)
+      matches.push_back(Match { s, ind });
+  }
+}
+
+int
+CIMenuFilter::
+score(std::string_view name, std::string_view query)
+{
+  size_t nq = query.size();
+
+  if (nq == 0)
+    return 0;
+
+  // find end of first match (vectorized scan for each query char)
+  size_t qi = 0, end = 0;
+
+  for (size_t pos = 0; qi < nq; ++qi, pos = end + 1) {
+    end = CIMenuMatch::findChar(name, pos, query[qi]);
+
+    if (end == std::string_view::npos)
+      return -1;
+  }
+
+  // find last start of match ending there (shortest match)
+  size_t start = end;
+
+  for (size_t i = end + 1; i-- > 0; ) {
+    if (lowerChar(name[i]) == lowerChar(query[qi - 1])) {
+      if (--qi == 0) {
+        start = i;
+        break;
+      }
+    }
+  }
+
+  //---
+
+  // score match characters, consecutive and word start matches and gaps
+  int  s         = 0;
+  bool lastMatch = false;
+
+  qi = 0;
+
+  for (size_t i = start; i <= end && qi < nq; ++i) {
+    if (lowerChar(name[i]) == lowerChar(query[qi])) {
+      s += 16;
+
+      if (lastMatch)
+        s += 8;
+
+      if (isWordStart(name, i))
+        s += 8;
+
+      if (name[i] == query[qi])
+        s += 1;
+
+      lastMatch = true;
+
+      ++qi;
+    }
+    else {
+      s -= 1;
+
+      lastMatch = false;
+    }
+  }
+
+  // prefer match near start
+  s -= int(std::min(start, size_t(15)));
+
+  return std::max(s, 0);
+}
@@ -0,0 +1,409 @@
+#include <CIMenuHistory.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char     s_magic[8] = { 'C', 'I', 'M', 'H', 'I', 'S', 'T', '\0' };
+const uint32_t s_version  = 1;
+
+const uint32_t s_initCapacity = 1024;
+
+uint32_t currentTime() {
+  return uint32_t(::time(nullptr));
+}
+
+}
+
+//---
+
+CIMenuHistory::
+CIMenuHistory(const std::string &filename) :
+ filename_(filename)
+{
+}
+
+CIMenuHistory::
+~CIMenuHistory()
+{
+  unmap();
+}
+
+bool
+CIMenuHistory::
+open()
+{
+  unmap();
+
+  now_ = currentTime();
+
+  int fd = ::open(filename_.c_str(), O_RDONLY);
+
+  if (fd < 0)
+    return (errno == ENOENT);
+
+  struct stat st;
+
+  if (::fstat(fd, &st) < 0) {
+    ::close(fd);
+    return false;
+  }
+
+  if (st.st_size == 0) {
+    ::close(fd);
+    return true;
+  }
+
+  void *p = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+  ::close(fd);
+
+  if (p == MAP_FAILED)
+    return false;
+
+  if (! isValid(p, size_t(st.st_size))) {
+    ::munmap(p, size_t(st.st_size));
+    return false;
+  }
+
+  data_ = static_cast<const char *>(p);
+  size_ = size_t(st.st_size);
+
+  // hash lookups touch pages at random
+  ::madvise(p, size_, MADV_RANDOM);
+
+  return true;
+}
+
+void
+CIMenuHistory::
+unmap()
+{
+  if (data_)
+    ::munmap(const_cast<char *>(data_), size_);
+
+  data_ = nullptr;
+  size_ = 0;
+}
+
+bool
+CIMenuHistory::
+isValid(const void *data, size_t size) const
+{
+  if (size < sizeof(Header))
+    return false;
+
+  const auto *header = static_cast<const Header *>(data);
+
+  if (memcmp(header->magic, s_magic, sizeof(s_magic)) != 0 || header->version != s_version)
+    return false;
+
+  uint32_t capacity = header->capacity;
+
+  if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+    return false;
+
+  // table is kept at most half full
+  if (header->count > capacity/2)
+    return false;
+
+  return (size == fileSize(capacity));
+}
+
+int
+CIMenuHistory::
+size() const
+{
+  if (! data_)
+    return 0;
+
+  return int(reinterpret_cast<const Header *>(data_)->count);
+}
+
+double
+CIMenuHistory::
+score(std::string_view command) const
+{
+  if (! data_)
+    return 0.0;
+
+  const auto *header  = reinterpret_cast<const Header *>(data_);
+  auto       *entries = tableEntries(const_cast<char *>(data_));
+
+  const auto *entry = findEntry(entries, header->capacity, hash(command));
+
+  // not found (or corrupt table with no empty entry)
+  if (! entry || ! entry->hash)
+    return 0.0;
+
+  // decay score from time of last use
+  double dt = (now_ > entry->time ? double(now_ - entry->time) : 0.0);
+
+  return entry->score*std::exp2(-dt/halfLife_);
+}
+
+bool
+CIMenuHistory::
+record(const Commands &commands)
+{
+  int fd = lockFile();
+
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+
+  if (::fstat(fd, &st) < 0) {
+    ::close(fd);
+    return false;
+  }
+
+  //---
+
+  // map existing table for in place update
+  size_t size = size_t(st.st_size);
+  void*  p    = nullptr;
+
+  uint32_t capacity = s_initCapacity;
+  uint32_t count    = 0;
+
+  if (size > 0) {
+    p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (p == MAP_FAILED) {
+      ::close(fd);
+      return false;
+    }
+
+    // never overwrite a file which is not a history file
+    if (! isValid(p, size)) {
+      ::munmap(p, size);
+      ::close(fd);
+      return false;
+    }
+
+    const auto *header = static_cast<const Header *>(p);
+
+    capacity = header->capacity;
+    count    = header->count;
+  }
+
+  // keep load factor at most 1/2
+  uint32_t newCapacity = capacity;
+
+  while (2*(count + uint32_t(commands.size())) > newCapacity)
+    newCapacity *= 2;
+
+  //---
+
+  bool rc = true;
+
+  if (size > 0 && newCapacity == capacity) {
+    rc = addCommands(p, commands);
+
+    ::munmap(p, size);
+  }
+  else {
+    // build new or grown table in memory (8 byte words for entry alignment)
+    std::vector<uint64_t> table(fileSize(newCapacity)/sizeof(uint64_t), 0);
+
+    void *newData = table.data();
+
+    auto *header  = static_cast<Header *>(newData);
+    auto *entries = tableEntries(newData);
+
+    memcpy(header->magic, s_magic, sizeof(s_magic));
+
+    header->version  = s_version;
+    header->capacity = newCapacity;
+    header->count    = count;
+    header->pad      = 0;
+
+    if (p) {
+      const auto *oldEntries = tableEntries(p);
+
+      for (uint32_t i = 0; i < capacity && rc; ++i) {
+        if (! oldEntries[i].hash)
+          continue;
+
+        // more entries than header count (corrupt table)
+        auto *entry = findEntry(entries, newCapacity, oldEntries[i].hash);
+
+        if (entry)
+          *entry = oldEntries[i];
+        else
+          rc = false;
+      }
+
+      ::munmap(p, size);
+    }
+
+    if (rc)
+      rc = addCommands(newData, commands);
+
+    // replace file (readers keep mapping of old file)
+    if (rc)
+      rc = replaceFile(newData, fileSize(newCapacity));
+  }
+
+  // unlock after file is replaced
+  ::close(fd);
+
+  if (! rc)
+    return false;
+
+  // remap updated file
+  return open();
+}
+
+// add commands to table (returns false if table is full)
+bool
+CIMenuHistory::
+addCommands(void *data, const Commands &commands) const
+{
+  auto *header  = static_cast<Header *>(data);
+  auto *entries = tableEntries(data);
+
+  uint32_t now = currentTime();
+
+  for (const auto &command : commands) {
+    uint64_t h = hash(command);
+
+    auto *entry = findEntry(entries, header->capacity, h);
+
+    if (! entry)
+      return false;
+
+    if (! entry->hash) {
+      entry->hash = h;
+
+      ++header->count;
+    }
+    else {
+      // decay old score to now
+      double dt = (now > entry->time ? double(now - entry->time) : 0.0);
+
+      entry->score *= std::exp2(-dt/halfLife_);
+    }
+
+    entry->time   = now;
+    entry->count += 1;
+    entry->score += 1.0;
+  }
+
+  return true;
+}
+
+// open and exclusively lock history file (returns -1 on error)
+int
+CIMenuHistory::
+lockFile() const
+{
+  for (;;) {
+    int fd = ::open(filename_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+    if (fd < 0)
+      return -1;
+
+    // serialize updates from concurrent menus
+    if (::flock(fd, LOCK_EX) < 0) {
+      ::close(fd);
+      return -1;
+    }
+
+    // retry if file was replaced while waiting for lock
+    struct stat st1, st2;
+
+    if (::fstat(fd, &st1) == 0 && ::stat(filename_.c_str(), &st2) == 0 &&
+        st1.st_dev == st2.st_dev && st1.st_ino == st2.st_ino)
+      return fd;
+
+    ::close(fd);
+  }
+}
+
+// write data to temporary file and rename it over history file
+bool
+CIMenuHistory::
+replaceFile(const void *data, size_t size) const
+{
+  std::string tempName = filename_ + ".XXXXXX";
+
+  int fd = ::mkstemp(&tempName[0]);
+
+  if (fd < 0)
+    return false;
+
+  const char *p = static_cast<const char *>(data);
+
+  bool rc = true;
+
+  for (size_t n = 0; n < size; ) {
+    ssize_t n1 = ::write(fd, p + n, size - n);
+
+    if (n1 < 0) {
+      if (errno == EINTR) continue;
+
+      rc = false;
+
+      break;
+    }
+
+    n += size_t(n1);
+  }
+
+  if (rc && (::fchmod(fd, 0644) < 0 || ::fsync(fd) < 0))
+    rc = false;
+
+  if (::close(fd) < 0)
+    rc = false;
+
+  if (rc && ::rename(tempName.c_str(), filename_.c_str()) < 0)
+    rc = false;
+
+  if (! rc)
+    ::unlink(tempName.c_str());
+
+  return rc;
+}
+
+CIMenuHistory::Entry *
+CIMenuHistory::
+findEntry(Entry *entries, uint32_t capacity, uint64_t h)
+{
+  // entry for hash or empty entry where it would be added (null if neither,
+  // only for a corrupt table as it is kept at most half full)
+  uint32_t mask = capacity - 1;
+
+  uint32_t i = uint32_t(h) & mask;
+
+  for (uint32_t n = 0; n < capacity; ++n, i = (i + 1) & mask) {
+    if (entries[i].hash == h || entries[i].hash == 0)
+      return &entries[i];
+  }
+
+  return nullptr;
+}
+
+uint64_t
+CIMenuHistory::
+hash(std::string_view str)
+{
+  uint64_t h = 14695981039346656037ULL;
+
+  for (const auto &c : str) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 1099511628211ULL;
+  }
+
+  return (h ? h : 1);
+}
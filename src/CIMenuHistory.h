@@ -0,0 +1,95 @@
+#ifndef CIMENU_HISTORY_H
+#define CIMENU_HISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// persistent frecency (frequency and recency) history of chosen commands
+//
+// the file is an open addressing hash table (linear probing) keyed by the
+// FNV-1a hash of the command which is memory mapped for lookups, so startup
+// cost does not depend on history size. Each use adds one to a score which
+// halves every halfLife seconds.
+class CIMenuHistory {
+ public:
+  typedef std::vector<std::string> Commands;
+
+ public:
+  CIMenuHistory(const std::string &filename);
+
+ ~CIMenuHistory();
+
+  CIMenuHistory(const CIMenuHistory &) = delete;
+  CIMenuHistory &operator=(const CIMenuHistory &) = delete;
+
+  const std::string &filename() const { return filename_; }
+
+  // get/set score half life (seconds)
+  double halfLife() const { return halfLife_; }
+  void setHalfLife(double t) { halfLife_ = t; }
+
+  // map history file (missing file is empty history, returns false on error)
+  bool open();
+
+  // number of commands in history
+  int size() const;
+
+  // current score of command (0 if not in history)
+  double score(std::string_view command) const;
+
+  // add use of commands and update file (returns false on error or if file
+  // exists and is not a history file). A grown table is written to a new
+  // file which replaces the old one so readers never see a partial table.
+  bool record(const Commands &commands);
+
+  // FNV-1a hash (never 0, which marks an empty entry)
+  static uint64_t hash(std::string_view str);
+
+ private:
+  struct Header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t capacity; // number of entries (power of two)
+    uint32_t count;    // number of used entries
+    uint32_t pad;
+  };
+
+  struct Entry {
+    uint64_t hash;  // command hash (0 if empty)
+    uint32_t time;  // time of last use (seconds since epoch)
+    uint32_t count; // number of uses
+    double   score; // score at time
+  };
+
+  static size_t fileSize(uint32_t capacity) {
+    return sizeof(Header) + capacity*sizeof(Entry);
+  }
+
+  static Entry *tableEntries(void *data) {
+    return reinterpret_cast<Entry *>(static_cast<char *>(data) + sizeof(Header));
+  }
+
+  static Entry *findEntry(Entry *entries, uint32_t capacity, uint64_t h);
+
+  bool isValid(const void *data, size_t size) const;
+
+  bool addCommands(void *data, const Commands &commands) const;
+
+  int lockFile() const;
+
+  bool replaceFile(const void *data, size_t size) const;
+
+  void unmap();
+
+ private:
+  std::string filename_;
+  double      halfLife_ { 7*24*3600.0 };
+  const char* data_     { nullptr };    // read only mapping
+  size_t      size_     { 0 };
+  uint32_t    now_      { 0 };          // time when opened
+};
+
+#endif
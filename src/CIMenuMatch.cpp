@@ -0,0 +1,307 @@
+#include <CIMenuMatch.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CIMENU_MATCH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using CIMenuMatch::lowerChar;
+
+inline char upperChar(char c) {
+  return (c >= 'a' && c <= 'z' ? char(c - 'a' + 'A') : c);
+}
+
+// compare n characters ignoring case
+inline bool equalNoCase(const char *s1, const char *s2, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    if (lowerChar(s1[i]) != lowerChar(s2[i]))
+      return false;
+  }
+
+  return true;
+}
+
+//---
+
+size_t findCharScalar(const char *s, size_t n, size_t pos, char c) {
+  char lc = lowerChar(c);
+
+  for (size_t i = pos; i < n; ++i) {
+    if (lowerChar(s[i]) == lc)
+      return i;
+  }
+
+  return std::string_view::npos;
+}
+
+bool containsSubstrScalar(const char *s, size_t n, const char *sub, size_t m) {
+  for (size_t i = 0; i + m <= n; ++i) {
+    if (equalNoCase(s + i, sub, m))
+      return true;
+  }
+
+  return false;
+}
+
+// successive character finds using specified find
+template<size_t (*FIND)(const char *, size_t, size_t, char)>
+bool containsSubseqT(const char *s, size_t n, const char *seq, size_t m) {
+  size_t pos = 0;
+
+  for (size_t i = 0; i < m; ++i) {
+    pos = FIND(s, n, pos, seq[i]);
+
+    if (pos == std::string_view::npos)
+      return false;
+
+    ++pos;
+  }
+
+  return true;
+}
+
+//---
+
+#ifdef CIMENU_MATCH_X86
+size_t findCharSSE2(const char *s, size_t n, size_t pos, char c) {
+  if (pos + 16 > n)
+    return findCharScalar(s, n, pos, c);
+
+  __m128i lc = _mm_set1_epi8(lowerChar(c));
+  __m128i uc = _mm_set1_epi8(upperChar(c));
+
+  size_t i = pos;
+
+  for ( ; i + 16 <= n; i += 16) {
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+
+    __m128i eq = _mm_or_si128(_mm_cmpeq_epi8(b, lc), _mm_cmpeq_epi8(b, uc));
+
+    unsigned mask = unsigned(_mm_movemask_epi8(eq));
+
+    if (mask)
+      return i + size_t(__builtin_ctz(mask));
+  }
+
+  return findCharScalar(s, n, i, c);
+}
+
+// compare first and last characters of sub at 16 positions per step
+bool containsSubstrSSE2(const char *s, size_t n, const char *sub, size_t m) {
+  if (m - 1 + 16 > n)
+    return containsSubstrScalar(s, n, sub, m);
+
+  __m128i lc1 = _mm_set1_epi8(lowerChar(sub[0]));
+  __m128i uc1 = _mm_set1_epi8(upperChar(sub[0]));
+  __m128i lc2 = _mm_set1_epi8(lowerChar(sub[m - 1]));
+  __m128i uc2 = _mm_set1_epi8(upperChar(sub[m - 1]));
+
+  size_t i = 0;
+
+  for ( ; i + m - 1 + 16 <= n; i += 16) {
+    __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+    __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i + m - 1));
+
+    __m128i eq1 = _mm_or_si128(_mm_cmpeq_epi8(b1, lc1), _mm_cmpeq_epi8(b1, uc1));
+    __m128i eq2 = _mm_or_si128(_mm_cmpeq_epi8(b2, lc2), _mm_cmpeq_epi8(b2, uc2));
+
+    unsigned mask = unsigned(_mm_movemask_epi8(_mm_and_si128(eq1, eq2)));
+
+    while (mask) {
+      size_t j = i + size_t(__builtin_ctz(mask));
+
+      if (equalNoCase(s + j + 1, sub + 1, m > 2 ? m - 2 : 0))
+        return true;
+
+      mask &= mask - 1;
+    }
+  }
+
+  return containsSubstrScalar(s + i, n - i, sub, m);
+}
+
+__attribute__((target("avx2")))
+size_t findCharAVX2(const char *s, size_t n, size_t pos, char c) {
+  if (pos + 32 > n)
+    return findCharSSE2(s, n, pos, c);
+
+  __m256i lc = _mm256_set1_epi8(lowerChar(c));
+  __m256i uc = _mm256_set1_epi8(upperChar(c));
+
+  size_t i = pos;
+
+  for ( ; i + 32 <= n; i += 32) {
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+
+    __m256i eq = _mm256_or_si256(_mm256_cmpeq_epi8(b, lc), _mm256_cmpeq_epi8(b, uc));
+
+    unsigned mask = unsigned(_mm256_movemask_epi8(eq));
+
+    if (mask)
+      return i + size_t(__builtin_ctz(mask));
+  }
+
+  // avoid AVX/SSE transition penalty in SSE2 tail
+  _mm256_zeroupper();
+
+  return findCharSSE2(s, n, i, c);
+}
+
+__attribute__((target("avx2")))
+bool containsSubstrAVX2(const char *s, size_t n, const char *sub, size_t m) {
+  if (m - 1 + 32 > n)
+    return containsSubstrSSE2(s, n, sub, m);
+
+  __m256i lc1 = _mm256_set1_epi8(lowerChar(sub[0]));
+  __m256i uc1 = _mm256_set1_epi8(upperChar(sub[0]));
+  __m256i lc2 = _mm256_set1_epi8(lowerChar(sub[m - 1]));
+  __m256i uc2 = _mm256_set1_epi8(upperChar(sub[m - 1]));
+
+  size_t i = 0;
+
+  for ( ; i + m - 1 + 32 <= n; i += 32) {
+    __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+    __m256i b2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i + m - 1));
+
+    __m256i eq1 = _mm256_or_si256(_mm256_cmpeq_epi8(b1, lc1), _mm256_cmpeq_epi8(b1, uc1));
+    __m256i eq2 = _mm256_or_si256(_mm256_cmpeq_epi8(b2, lc2), _mm256_cmpeq_epi8(b2, uc2));
+
+    unsigned mask = unsigned(_mm256_movemask_epi8(_mm256_and_si256(eq1, eq2)));
+
+    while (mask) {
+      size_t j = i + size_t(__builtin_ctz(mask));
+
+      if (equalNoCase(s + j + 1, sub + 1, m > 2 ? m - 2 : 0))
+        return true;
+
+      mask &= mask - 1;
+    }
+  }
+
+  _mm256_zeroupper();
+
+  return containsSubstrSSE2(s + i, n - i, sub, m);
+}
+#endif
+
+//---
+
+using FindCharProc = size_t (*)(const char *, size_t, size_t, char);
+using ContainsProc = bool   (*)(const char *, size_t, const char *, size_t);
+
+struct Procs {
+  CIMenuMatch::Impl impl           { CIMenuMatch::Impl::SCALAR };
+  FindCharProc      findChar       { findCharScalar };
+  ContainsProc      containsSubstr { containsSubstrScalar };
+  ContainsProc      containsSubseq { containsSubseqT<findCharScalar> };
+};
+
+Procs makeProcs(CIMenuMatch::Impl impl) {
+  Procs procs;
+
+#ifdef CIMENU_MATCH_X86
+  if      (impl == CIMenuMatch::Impl::AVX2) {
+    procs.impl           = impl;
+    procs.findChar       = findCharAVX2;
+    procs.containsSubstr = containsSubstrAVX2;
+    procs.containsSubseq = containsSubseqT<findCharAVX2>;
+  }
+  else if (impl == CIMenuMatch::Impl::SSE2) {
+    procs.impl           = impl;
+    procs.findChar       = findCharSSE2;
+    procs.containsSubstr = containsSubstrSSE2;
+    procs.containsSubseq = containsSubseqT<findCharSSE2>;
+  }
+#else
+  (void) impl;
+#endif
+
+  return procs;
+}
+
+Procs &currentProcs() {
+  static Procs procs = makeProcs(CIMenuMatch::bestImpl());
+
+  return procs;
+}
+
+}
+
+//---
+
+CIMenuMatch::Impl
+CIMenuMatch::
+bestImpl()
+{
+#ifdef CIMENU_MATCH_X86
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2"))
+    return Impl::AVX2;
+
+  if (__builtin_cpu_supports("sse2"))
+    return Impl::SSE2;
+#endif
+
+  return Impl::SCALAR;
+}
+
+CIMenuMatch::Impl
+CIMenuMatch::
+impl()
+{
+  return currentProcs().impl;
+}
+
+void
+CIMenuMatch::
+setImpl(Impl impl)
+{
+  if (int(impl) > int(bestImpl()))
+    impl = bestImpl();
+
+  currentProcs() = makeProcs(impl);
+}
+
+const char *
+CIMenuMatch::
+implName(Impl impl)
+{
+  switch (impl) {
+    case Impl::SSE2: return "sse2";
+    case Impl::AVX2: return "avx2";
+    default        : return "scalar";
+  }
+}
+
+size_t
+CIMenuMatch::
+findChar(std::string_view str, size_t pos, char c)
+{
+  return currentProcs().findChar(str.data(), str.size(), pos, c);
+}
+
+bool
+CIMenuMatch::
+containsSubstr(std::string_view str, std::string_view sub)
+{
+  if (sub.empty())
+    return true;
+
+  if (sub.size() > str.size())
+    return false;
+
+  return currentProcs().containsSubstr(str.data(), str.size(), sub.data(), sub.size());
+}
+
+bool
+CIMenuMatch::
+containsSubseq(std::string_view str, std::string_view seq)
+{
+  if (seq.size() > str.size())
+    return false;
+
+  return currentProcs().containsSubseq(str.data(), str.size(), seq.data(), seq.size());
+}
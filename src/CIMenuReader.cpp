@@ -0,0 +1,176 @@
+#include <CIMenuReader.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+CIMenuReader::
+CIMenuReader(int fd) :
+ fd_(fd)
+{
+}
+
+CIMenuReader::
+~CIMenuReader()
+{
+  if (thread_.joinable()) {
+    // wake reader blocked in poll
+    if (stopFds_[1] >= 0)
+      (void) ::write(stopFds_[1], "x", 1);
+
+    thread_.join();
+  }
+
+  for (auto &fd : stopFds_) {
+    if (fd >= 0)
+      ::close(fd);
+  }
+
+  for (auto &fd : notifyFds_) {
+    if (fd >= 0)
+      ::close(fd);
+  }
+}
+
+bool
+CIMenuReader::
+start()
+{
+  if (::pipe(stopFds_) < 0)
+    return false;
+
+  if (::pipe2(notifyFds_, O_NONBLOCK | O_CLOEXEC) < 0)
+    return false;
+
+  thread_ = std::thread(&CIMenuReader::run, this);
+
+  return true;
+}
+
+bool
+CIMenuReader::
+takeItems(Names &names)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (pending_.empty())
+    return false;
+
+  // pending lines are all taken
+  char buffer[16];
+
+  while (::read(notifyFds_[0], buffer, sizeof(buffer)) > 0)
+    ;
+
+  if (names.empty())
+    names.swap(pending_);
+  else {
+    for (auto &name : pending_)
+      names.push_back(std::move(name));
+
+    pending_.clear();
+  }
+
+  return true;
+}
+
+void
+CIMenuReader::
+run()
+{
+  static const size_t bufferSize = 64*1024;
+
+  std::vector<char> buffer(bufferSize);
+
+  struct pollfd fds[2];
+
+  fds[0].fd     = fd_;
+  fds[0].events = POLLIN;
+  fds[1].fd     = stopFds_[0];
+  fds[1].events = POLLIN;
+
+  for (;;) {
+    fds[0].revents = 0;
+    fds[1].revents = 0;
+
+    if (::poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+
+    // stop requested
+    if (fds[1].revents)
+      break;
+
+    ssize_t n = ::read(fd_, &buffer[0], bufferSize);
+
+    if (n < 0) {
+      if (errno == EINTR || errno == EAGAIN) continue;
+      break;
+    }
+
+    if (n == 0)
+      break;
+
+    addLines(&buffer[0], size_t(n), false);
+  }
+
+  addLines(nullptr, 0, true);
+
+  done_ = true;
+}
+
+void
+CIMenuReader::
+addLines(const char *data, size_t len, bool eof)
+{
+  Names lines;
+
+  const char *end = data + len;
+
+  while (data < end) {
+    auto *nl = static_cast<const char *>(memchr(data, '\n', size_t(end - data)));
+
+    if (! nl) {
+      partial_.append(data, size_t(end - data));
+      break;
+    }
+
+    if (partial_.empty())
+      lines.emplace_back(data, size_t(nl - data));
+    else {
+      partial_.append(data, size_t(nl - data));
+
+      lines.push_back(std::move(partial_));
+
+      partial_.clear();
+    }
+
+    data = nl + 1;
+  }
+
+  // unterminated last line
+  if (eof && ! partial_.empty()) {
+    lines.push_back(std::move(partial_));
+
+    partial_.clear();
+  }
+
+  if (lines.empty())
+    return;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (pending_.empty()) {
+    pending_.swap(lines);
+
+    // wake menu (only needed when first lines are pending)
+    (void) ::write(notifyFds_[1], "x", 1);
+  }
+  else {
+    for (auto &line : lines)
+      pending_.push_back(std::move(line));
+  }
+}
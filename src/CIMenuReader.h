@@ -0,0 +1,54 @@
+#ifndef CIMENU_READER_H
+#define CIMENU_READER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// background reader of newline separated items from a file descriptor
+//
+// lines are collected on a reader thread and handed to the menu in batches
+// by takeItems(). The notify fd is readable while lines are pending.
+class CIMenuReader {
+ public:
+  typedef std::vector<std::string> Names;
+
+ public:
+  CIMenuReader(int fd);
+
+ ~CIMenuReader();
+
+  CIMenuReader(const CIMenuReader &) = delete;
+  CIMenuReader &operator=(const CIMenuReader &) = delete;
+
+  // start reader thread
+  bool start();
+
+  // get items read since last call (returns false if none)
+  bool takeItems(Names &names);
+
+  // all input read
+  bool isDone() const { return done_; }
+
+  // fd readable when items are pending (-1 if not started)
+  int notifyFd() const { return notifyFds_[0]; }
+
+ private:
+  void run();
+
+  void addLines(const char *data, size_t len, bool eof);
+
+ private:
+  int               fd_           { -1 };
+  int               stopFds_[2]   { -1, -1 }; // pipe to interrupt reader
+  int               notifyFds_[2] { -1, -1 }; // pipe to signal pending lines
+  std::thread       thread_;
+  std::mutex        mutex_;
+  Names             pending_;                 // lines not yet taken
+  std::string       partial_;                 // incomplete last line
+  std::atomic<bool> done_         { false };
+};
+
+#endif
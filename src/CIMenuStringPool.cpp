@@ -0,0 +1,42 @@
+#include <CIMenuStringPool.h>
+
+#include <cstring>
+
+std::string_view
+CIMenuStringPool::
+add(std::string_view str)
+{
+  if (str.empty())
+    return std::string_view("", 0);
+
+  auto *p = static_cast<char *>(chars_.allocate(str.size(), 1));
+
+  memcpy(p, str.data(), str.size());
+
+  return std::string_view(p, str.size());
+}
+
+std::string_view
+CIMenuStringPool::
+intern(std::string_view str)
+{
+  auto p = interned_.find(str);
+
+  if (p != interned_.end())
+    return *p;
+
+  auto str1 = add(str);
+
+  interned_.insert(str1);
+
+  return str1;
+}
+
+void
+CIMenuStringPool::
+clear()
+{
+  interned_.clear();
+
+  chars_.clear();
+}
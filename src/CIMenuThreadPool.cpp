@@ -0,0 +1,77 @@
+#include <CIMenuThreadPool.h>
+
+CIMenuThreadPool::
+CIMenuThreadPool(int numThreads)
+{
+  if (numThreads <= 0)
+    numThreads = int(std::thread::hardware_concurrency());
+
+  if (numThreads <= 0)
+    numThreads = 1;
+
+  for (int i = 0; i < numThreads; ++i)
+    threads_.emplace_back(&CIMenuThreadPool::worker, this);
+}
+
+CIMenuThreadPool::
+~CIMenuThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    stop_ = true;
+  }
+
+  startCond_.notify_all();
+
+  for (auto &thread : threads_)
+    thread.join();
+}
+
+void
+CIMenuThreadPool::
+run(int n, const Proc &proc)
+{
+  if (n <= 0)
+    return;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  proc_     = &proc;
+  numTasks_ = n;
+  nextTask_ = 0;
+  numDone_  = 0;
+
+  startCond_.notify_all();
+
+  doneCond_.wait(lock, [&]() { return numDone_ == numTasks_; });
+
+  proc_     = nullptr;
+  numTasks_ = 0;
+}
+
+void
+CIMenuThreadPool::
+worker()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  for (;;) {
+    startCond_.wait(lock, [&]() { return stop_ || nextTask_ < numTasks_; });
+
+    if (stop_)
+      break;
+
+    int         task = nextTask_++;
+    const auto *proc = proc_;
+
+    lock.unlock();
+
+    (*proc)(task);
+
+    lock.lock();
+
+    if (++numDone_ == numTasks_)
+      doneCond_.notify_all();
+  }
+}
@@ -0,0 +1,46 @@
+#ifndef CIMENU_THREAD_POOL_H
+#define CIMENU_THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed size pool of worker threads for parallel loops
+class CIMenuThreadPool {
+ public:
+  typedef std::function<void (int)> Proc;
+
+ public:
+  // create pool (0 threads uses hardware concurrency)
+  CIMenuThreadPool(int numThreads=0);
+
+ ~CIMenuThreadPool();
+
+  CIMenuThreadPool(const CIMenuThreadPool &) = delete;
+  CIMenuThreadPool &operator=(const CIMenuThreadPool &) = delete;
+
+  int numThreads() const { return int(threads_.size()); }
+
+  // run proc(i) for i in [0, n) on pool threads and wait for completion
+  void run(int n, const Proc &proc);
+
+ private:
+  void worker();
+
+ private:
+  typedef std::vector<std::thread> Threads;
+
+  Threads                 threads_;
+  std::mutex              mutex_;
+  std::condition_variable startCond_;
+  std::condition_variable doneCond_;
+  const Proc*             proc_      { nullptr }; // current job
+  int                     numTasks_  { 0 };       // number of tasks in job
+  int                     nextTask_  { 0 };       // next task to start
+  int                     numDone_   { 0 };       // number of tasks finished
+  bool                    stop_      { false };
+};
+
+#endif
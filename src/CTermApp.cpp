@@ -2,349 +2,766 @@
 #include <COSRead.h>
 #include <COSPty.h>
 #include <COSTerm.h>
-#include <CStrParse.h>
 #include <CEscape.h>
 
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
 #include <termios.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
 
+namespace {
+
+typedef std::array<CKeyType, 256> KeyTable;
+
+// key type for each input byte (unlisted bytes are CKEY_TYPE_NUL)
+constexpr KeyTable makeKeyTable() {
+  KeyTable table {};
+
+  for (auto &type : table)
+    type = CKEY_TYPE_NUL;
+
+  table[0x00  ] = CKEY_TYPE_NUL;
+  table[0x01  ] = CKEY_TYPE_SOH;
+  table[0x02  ] = CKEY_TYPE_STX;
+  table[0x03  ] = CKEY_TYPE_ETX;
+  table[0x04  ] = CKEY_TYPE_EOT;
+  table[0x05  ] = CKEY_TYPE_ENQ;
+  table[0x06  ] = CKEY_TYPE_ACK;
+  table[0x07  ] = CKEY_TYPE_BEL;
+  table[0x08  ] = CKEY_TYPE_BackSpace;
+  table[0x09  ] = CKEY_TYPE_TAB;
+  table[0x0a  ] = CKEY_TYPE_LineFeed;
+  table[0x0b  ] = CKEY_TYPE_Clear;
+  table[0x0c  ] = CKEY_TYPE_FF;
+  table[0x0d  ] = CKEY_TYPE_Return;
+  table[0x0e  ] = CKEY_TYPE_SO;
+  table[0x0f  ] = CKEY_TYPE_SI;
+  table[0x10  ] = CKEY_TYPE_DLE;
+  table[0x11  ] = CKEY_TYPE_DC1;
+  table[0x12  ] = CKEY_TYPE_DC2;
+  table[0x13  ] = CKEY_TYPE_Pause;
+  table[0x14  ] = CKEY_TYPE_Scroll_Lock;
+  table[0x15  ] = CKEY_TYPE_Sys_Req;
+  table[0x16  ] = CKEY_TYPE_SYN;
+  table[0x17  ] = CKEY_TYPE_ETB;
+  table[0x18  ] = CKEY_TYPE_CAN;
+  table[0x19  ] = CKEY_TYPE_EM;
+  table[0x1a  ] = CKEY_TYPE_SUB;
+  table[0x1b  ] = CKEY_TYPE_Escape;
+  table[0x1c  ] = CKEY_TYPE_FS;
+  table[0x1d  ] = CKEY_TYPE_GS;
+  table[0x1e  ] = CKEY_TYPE_RS;
+  table[0x1f  ] = CKEY_TYPE_US;
+  table[' '   ] = CKEY_TYPE_Space;
+  table['!'   ] = CKEY_TYPE_Space;
+  table['"'   ] = CKEY_TYPE_QuoteDbl;
+  table['#'   ] = CKEY_TYPE_NumberSign;
+  table['$'   ] = CKEY_TYPE_Dollar;
+  table['%'   ] = CKEY_TYPE_Percent;
+  table['&'   ] = CKEY_TYPE_Ampersand;
+  table['\''  ] = CKEY_TYPE_Apostrophe;
+  table['('   ] = CKEY_TYPE_ParenLeft;
+  table[')'   ] = CKEY_TYPE_ParenRight;
+  table['*'   ] = CKEY_TYPE_Asterisk;
+  table['+'   ] = CKEY_TYPE_Plus;
+  table[','   ] = CKEY_TYPE_Comma;
+  table['-'   ] = CKEY_TYPE_Minus;
+  table['.'   ] = CKEY_TYPE_Period;
+  table['/'   ] = CKEY_TYPE_Slash;
+  table['0'   ] = CKEY_TYPE_0;
+  table['1'   ] = CKEY_TYPE_1;
+  table['2'   ] = CKEY_TYPE_2;
+  table['3'   ] = CKEY_TYPE_3;
+  table['4'   ] = CKEY_TYPE_4;
+  table['5'   ] = CKEY_TYPE_5;
+  table['6'   ] = CKEY_TYPE_6;
+  table['7'   ] = CKEY_TYPE_7;
+  table['8'   ] = CKEY_TYPE_8;
+  table['9'   ] = CKEY_TYPE_9;
+  table[':'   ] = CKEY_TYPE_Colon;
+  table[';'   ] = CKEY_TYPE_Semicolon;
+  table['<'   ] = CKEY_TYPE_Less;
+  table['='   ] = CKEY_TYPE_Equal;
+  table['>'   ] = CKEY_TYPE_Greater;
+  table['?'   ] = CKEY_TYPE_Question;
+  table['@'   ] = CKEY_TYPE_At;
+  table['A'   ] = CKEY_TYPE_A;
+  table['B'   ] = CKEY_TYPE_B;
+  table['C'   ] = CKEY_TYPE_C;
+  table['D'   ] = CKEY_TYPE_D;
+  table['E'   ] = CKEY_TYPE_E;
+  table['F'   ] = CKEY_TYPE_F;
+  table['G'   ] = CKEY_TYPE_G;
+  table['H'   ] = CKEY_TYPE_H;
+  table['I'   ] = CKEY_TYPE_I;
+  table['J'   ] = CKEY_TYPE_J;
+  table['K'   ] = CKEY_TYPE_K;
+  table['L'   ] = CKEY_TYPE_L;
+  table['M'   ] = CKEY_TYPE_M;
+  table['N'   ] = CKEY_TYPE_N;
+  table['O'   ] = CKEY_TYPE_O;
+  table['P'   ] = CKEY_TYPE_P;
+  table['Q'   ] = CKEY_TYPE_Q;
+  table['R'   ] = CKEY_TYPE_R;
+  table['S'   ] = CKEY_TYPE_S;
+  table['T'   ] = CKEY_TYPE_T;
+  table['U'   ] = CKEY_TYPE_U;
+  table['V'   ] = CKEY_TYPE_V;
+  table['W'   ] = CKEY_TYPE_W;
+  table['X'   ] = CKEY_TYPE_X;
+  table['Y'   ] = CKEY_TYPE_Y;
+  table['Z'   ] = CKEY_TYPE_Z;
+  table['['   ] = CKEY_TYPE_BracketLeft;
+  table['\\'  ] = CKEY_TYPE_Backslash;
+  table[']'   ] = CKEY_TYPE_BracketRight;
+  table['~'   ] = CKEY_TYPE_AsciiCircum;
+  table['_'   ] = CKEY_TYPE_Underscore;
+  table['`'   ] = CKEY_TYPE_QuoteLeft;
+  table['a'   ] = CKEY_TYPE_a;
+  table['b'   ] = CKEY_TYPE_b;
+  table['c'   ] = CKEY_TYPE_c;
+  table['d'   ] = CKEY_TYPE_d;
+  table['e'   ] = CKEY_TYPE_e;
+  table['f'   ] = CKEY_TYPE_f;
+  table['g'   ] = CKEY_TYPE_g;
+  table['h'   ] = CKEY_TYPE_h;
+  table['i'   ] = CKEY_TYPE_i;
+  table['j'   ] = CKEY_TYPE_j;
+  table['k'   ] = CKEY_TYPE_k;
+  table['l'   ] = CKEY_TYPE_l;
+  table['m'   ] = CKEY_TYPE_m;
+  table['n'   ] = CKEY_TYPE_n;
+  table['o'   ] = CKEY_TYPE_o;
+  table['p'   ] = CKEY_TYPE_p;
+  table['q'   ] = CKEY_TYPE_q;
+  table['r'   ] = CKEY_TYPE_r;
+  table['s'   ] = CKEY_TYPE_s;
+  table['t'   ] = CKEY_TYPE_t;
+  table['u'   ] = CKEY_TYPE_u;
+  table['v'   ] = CKEY_TYPE_v;
+  table['w'   ] = CKEY_TYPE_w;
+  table['x'   ] = CKEY_TYPE_x;
+  table['y'   ] = CKEY_TYPE_y;
+  table['z'   ] = CKEY_TYPE_z;
+  table['{'   ] = CKEY_TYPE_BraceLeft;
+  table['|'   ] = CKEY_TYPE_Bar;
+  table['}'   ] = CKEY_TYPE_BraceRight;
+  table[0x7f  ] = CKEY_TYPE_DEL;
+
+  return table;
+}
+
+constexpr KeyTable s_keyTable = makeKeyTable();
+
+}
+
+int CTermApp::s_signalFds[2] = { -1, -1 };
+
 CTermApp::
-CTermApp()
+CTermApp() :
+ input_(this)
 {
-  setRaw(STDIN_FILENO);
+  // read keys from terminal if stdin is redirected (e.g. items piped in)
+  inputFd_ = STDIN_FILENO;
+
+  if (! isatty(STDIN_FILENO)) {
+    int fd = open("/dev/tty", O_RDWR);
+
+    if (fd >= 0)
+      inputFd_ = fd;
+  }
+
+  setRaw(inputFd_);
+
+  updateWindowSize();
 }
 
 CTermApp::
 ~CTermApp()
 {
-  resetRaw(STDIN_FILENO);
+  resetRaw(inputFd_);
+
+  if (inputFd_ != STDIN_FILENO)
+    close(inputFd_);
 }
 
 void
 CTermApp::
 mainLoop()
 {
+  running_ = true;
+
   if (mouse_)
-    COSRead::write(STDOUT_FILENO, CEscape::DECSET(1002));
+    writeMouseMode(true);
+
+  updateWindowSize();
 
   redraw();
 
-  if (autoExit_) return;
+  if (autoExit_) {
+    if (mouse_)
+      writeMouseMode(false);
 
-  for (;;) {
-    if (! COSRead::wait_read(STDIN_FILENO, 0, 100)) continue;
+    running_ = false;
 
-    std::string buffer;
+    return;
+  }
+
+  // redraw for new terminal size
+  addSignal(SIGWINCH, [this]() { updateWindowSize(); return true; });
+
+  std::vector<struct pollfd> fds;
+
+  while (! done_) {
+    // terminal input, signal pipe then registered fds
+    fds.clear();
+
+    fds.push_back({ inputFd_      , POLLIN, 0 });
+    fds.push_back({ s_signalFds[0], POLLIN, 0 });
+
+    for (const auto &inputFd : inputFds_)
+      fds.push_back({ inputFd.fd, POLLIN, 0 });
+
+    // block until event or next timer
+    if (::poll(&fds[0], fds.size(), timerTimeout()) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+
+    bool changed = false;
+
+    if (fds[1].revents & POLLIN) {
+      if (processSignals())
+        changed = true;
+    }
+
+    if (fds[0].revents) {
+      int n = readInput();
+
+      if      (n > 0)
+        changed = true;
+      // terminal gone
+      else if (n < 0 && (fds[0].revents & (POLLHUP | POLLERR)))
+        break;
+    }
 
-    if (! COSRead::read(STDIN_FILENO, buffer)) continue;
+    if (done_) break;
 
-    uint len = uint(buffer.size());
+    for (size_t i = 2; i < fds.size(); ++i) {
+      if (fds[i].revents && processInputFd(fds[i].fd))
+        changed = true;
+    }
 
-    if (len == 0) continue;
+    if (processTimers())
+      changed = true;
 
-    processString(buffer);
+    if (idle())
+      changed = true;
 
     if (done_) break;
 
-    redraw();
+    if (changed)
+      updateDisplay();
+  }
+
+  if (redrawTimer_) {
+    removeTimer(redrawTimer_);
+
+    redrawTimer_ = 0;
   }
 
+  if (escapeTimer_) {
+    removeTimer(escapeTimer_);
+
+    escapeTimer_ = 0;
+  }
+
+  removeSignal(SIGWINCH);
+
   if (mouse_)
-    COSRead::write(STDOUT_FILENO, CEscape::DECRST(1002));
+    writeMouseMode(false);
+
+  running_ = false;
 }
 
 void
 CTermApp::
-processString(const std::string &str)
+setMouse(bool mouse)
 {
-  inEscape_ = false;
+  if (mouse == mouse_)
+    return;
 
-  uint i   = 0;
-  uint len = uint(str.size());
+  mouse_ = mouse;
 
-  //---
+  if (running_)
+    writeMouseMode(mouse_);
+}
 
-  // process mouse (only if mouse enabled ?)
-  static int pressButton = 0;
+// button event tracking with SGR (1006) reports (cell positions not limited
+// to 223 and release reports button)
+void
+CTermApp::
+writeMouseMode(bool enable)
+{
+  if (enable)
+    COSRead::write(STDOUT_FILENO, CEscape::DECSET(1002, 1006));
+  else
+    COSRead::write(STDOUT_FILENO, CEscape::DECRST(1002, 1006));
+}
 
-  int  button, col, row;
-  bool release;
+void
+CTermApp::
+addInputFd(int fd, const Proc &proc)
+{
+  removeInputFd(fd);
 
-  if (len == 6 && CEscape::parseMouse(str, &button, &col, &row, &release)) {
-    int rows, cols, width, height;
+  InputFd inputFd;
 
-    if (! CEscape::getWindowCharSize(&rows, &cols))
-      return;
+  inputFd.fd   = fd;
+  inputFd.proc = proc;
 
-    if (! CEscape::getWindowPixelSize(&width, &height))
-      return;
+  inputFds_.push_back(inputFd);
+}
+
+void
+CTermApp::
+removeInputFd(int fd)
+{
+  auto p = std::remove_if(inputFds_.begin(), inputFds_.end(),
+                          [&](const InputFd &inputFd) { return inputFd.fd == fd; });
+
+  inputFds_.erase(p, inputFds_.end());
+}
 
-    if (rows <= 0) rows = 1;
-    if (cols <= 0) cols = 1;
+bool
+CTermApp::
+processInputFd(int fd)
+{
+  // copy proc as it may remove fd
+  Proc proc;
 
-    int cw = width /cols;
-    int ch = height/rows;
+  for (const auto &inputFd : inputFds_) {
+    if (inputFd.fd == fd) {
+      proc = inputFd.proc;
+      break;
+    }
+  }
 
-    int x1 = (col - 1)*cw + cw/2;
-    int y1 = (row - 1)*ch + ch/2;
+  return (proc && proc());
+}
 
-    CIPoint2D pos(x1, y1);
+int
+CTermApp::
+addTimer(int msecs, const Proc &proc, bool repeat)
+{
+  Timer timer;
 
-    if (! release) {
-      CMouseEvent event(pos, CMouseButton(button + 1));
+  timer.id     = ++timerId_;
+  timer.time   = std::chrono::steady_clock::now() + std::chrono::milliseconds(msecs);
+  timer.msecs  = msecs;
+  timer.repeat = repeat;
+  timer.proc   = proc;
 
-      mousePress(event);
+  timers_.push_back(timer);
 
-      pressButton = button;
-    }
-    else {
-      CMouseEvent event(pos, CMouseButton(pressButton + 1));
+  return timer.id;
+}
 
-      mouseRelease(event);
-    }
+void
+CTermApp::
+removeTimer(int id)
+{
+  auto p = std::remove_if(timers_.begin(), timers_.end(),
+                          [&](const Timer &timer) { return timer.id == id; });
 
-    return;
-  }
+  timers_.erase(p, timers_.end());
+}
 
-  //---
+// msecs until next timer expires (-1 if no timers)
+int
+CTermApp::
+timerTimeout() const
+{
+  if (timers_.empty())
+    return -1;
 
-  // skip status report
-  if (len > 8 && str[0] == '' && str[1] == '[' && str[len - 1] == 't')
-    return;
+  auto now = std::chrono::steady_clock::now();
 
-  //---
+  auto time = timers_[0].time;
 
-  for (uint pos = 0; pos < len; ++pos) {
-    if (processStringChar(str[pos]))
-      i = pos + 1;
+  for (const auto &timer : timers_)
+    time = std::min(time, timer.time);
 
-    if (done_) return;
+  if (time <= now)
+    return 0;
+
+  // round up so timer has expired on wakeup
+  auto usecs = std::chrono::duration_cast<std::chrono::microseconds>(time - now).count();
+
+  return int((usecs + 999)/1000);
+}
+
+bool
+CTermApp::
+processTimers()
+{
+  bool changed = false;
+
+  auto now = std::chrono::steady_clock::now();
+
+  // collect expired timers first as procs may add/remove timers
+  std::vector<Proc> procs;
+
+  for (auto &timer : timers_) {
+    if (timer.time > now)
+      continue;
+
+    procs.push_back(timer.proc);
+
+    if (timer.repeat)
+      timer.time = now + std::chrono::milliseconds(timer.msecs);
+    else
+      timer.id = 0;
   }
 
-  if (i < len) {
-    for (uint pos = i; pos < len; ++pos) {
-      processChar(str[pos]);
+  timers_.erase(std::remove_if(timers_.begin(), timers_.end(),
+                               [](const Timer &timer) { return timer.id == 0; }),
+                timers_.end());
 
-      if (done_) return;
-    }
+  for (auto &proc : procs) {
+    if (proc())
+      changed = true;
   }
+
+  return changed;
 }
 
 bool
 CTermApp::
-processStringChar(unsigned char c)
+addSignal(int sig, const Proc &proc)
 {
-  if (c == '') { // control backslash
-    resetRaw(STDIN_FILENO);
-    exit(1);
+  // self pipe (signal handler writes signal number)
+  if (s_signalFds[0] < 0) {
+    if (::pipe2(s_signalFds, O_NONBLOCK | O_CLOEXEC) < 0)
+      return false;
   }
 
-  CKeyEvent event;
+  removeSignal(sig);
 
-  if (! inEscape_) {
-    if (c == '\033') {
-      inEscape_     = true;
-      escapeString_ = std::string(reinterpret_cast<const char *>(&c), 1);
-      return false;
-    }
+  auto &signal = signals_[sig];
+
+  signal.proc = proc;
+
+  struct sigaction action;
 
-    processChar(c);
+  memset(&action, 0, sizeof(action));
 
-    return true;
+  action.sa_handler = &CTermApp::signalHandler;
+  action.sa_flags   = SA_RESTART;
+
+  sigemptyset(&action.sa_mask);
+
+  if (::sigaction(sig, &action, &signal.oldAction) < 0) {
+    signals_.erase(sig);
+    return false;
   }
-  else {
-    escapeString_ += c;
 
-    CStrParse parse(escapeString_);
+  return true;
+}
 
-    if (! parse.isChar(''))
-      return false;
+void
+CTermApp::
+removeSignal(int sig)
+{
+  auto p = signals_.find(sig);
 
-    parse.skipChar();
+  if (p == signals_.end())
+    return;
 
-    if (! parse.isChar('['))
-      return false;
+  (void) ::sigaction(sig, &(*p).second.oldAction, nullptr);
 
-    parse.skipChar();
+  signals_.erase(p);
+}
 
-    while (parse.isDigit()) {
-      int i;
+void
+CTermApp::
+signalHandler(int sig)
+{
+  int saveErrno = errno;
 
-      parse.readInteger(&i);
+  unsigned char c = static_cast<unsigned char>(sig);
 
-      if (! parse.isChar(';'))
-        break;
+  (void) ::write(s_signalFds[1], &c, 1);
 
-      parse.skipChar();
-    }
+  errno = saveErrno;
+}
 
-    if (! parse.isAlpha())
-      return false;
+bool
+CTermApp::
+processSignals()
+{
+  bool changed = false;
+
+  unsigned char buffer[64];
+
+  ssize_t n;
 
-    char c1 = parse.getCharAt();
+  while ((n = ::read(s_signalFds[0], buffer, sizeof(buffer))) > 0) {
+    for (ssize_t i = 0; i < n; ++i) {
+      auto p = signals_.find(int(buffer[i]));
 
-    if      (c1 == 'A') { // up
-      event.setType(CKEY_TYPE_Up);
+      if (p == signals_.end())
+        continue;
+
+      auto proc = (*p).second.proc;
+
+      if (proc && proc())
+        changed = true;
     }
-    else if (c1 == 'B') { // down
-      event.setType(CKEY_TYPE_Down);
+  }
+
+  return changed;
+}
+
+// read and decode all queued terminal input so a burst (paste, key repeat)
+// is applied before a single redraw (returns bytes read, -1 on error/eof)
+int
+CTermApp::
+readInput()
+{
+  static const int maxReads = 64; // bound so display still updates for flood
+
+  int numRead = 0;
+
+  // input continues pending escape
+  if (escapeTimer_) {
+    removeTimer(escapeTimer_);
+
+    escapeTimer_ = 0;
+  }
+
+  for (int i = 0; i < maxReads; ++i) {
+    ssize_t n = ::read(inputFd_, inputBuffer_, sizeof(inputBuffer_));
+
+    if (n < 0 && errno == EINTR)
+      continue;
+
+    if (n <= 0)
+      return (numRead > 0 ? numRead : -1);
+
+    numRead += int(n);
+
+    processInput(inputBuffer_, size_t(n));
+
+    if (done_)
+      return numRead;
+
+    // stop if no more input queued
+    struct pollfd fd { inputFd_, POLLIN, 0 };
+
+    if (::poll(&fd, 1, 0) <= 0 || ! (fd.revents & POLLIN))
+      break;
+  }
+
+  // escape at end of burst may start a sequence split over reads (e.g. over
+  // ssh) so it is only the Escape key if nothing follows within timeout
+  if (input_.state() == CTermInput::State::ESCAPE) {
+    escapeTimer_ = addTimer(escapeMSecs_, [this]() {
+      escapeTimer_ = 0;
+
+      input_.flush();
+
+      return true;
+    });
+  }
+
+  return numRead;
+}
+
+void
+CTermApp::
+processInput(const char *data, size_t len)
+{
+  for (size_t i = 0; i < len; ++i) {
+    input_.put(static_cast<unsigned char>(data[i]));
+
+    if (done_) return;
+  }
+}
+
+// redraw now or, if frame rate is capped and last frame is too recent, when
+// frame interval ends (later requests are merged into pending redraw)
+void
+CTermApp::
+updateDisplay()
+{
+  using Clock = std::chrono::steady_clock;
+
+  if (maxFrameRate_ > 0) {
+    if (redrawTimer_)
+      return;
+
+    auto frameTime = std::chrono::microseconds(1000000/maxFrameRate_);
+
+    auto t = Clock::now();
+
+    if (t < lastRedraw_ + frameTime) {
+      auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    lastRedraw_ + frameTime - t + std::chrono::microseconds(999));
+
+      redrawTimer_ = addTimer(int(wait.count()), [this]() {
+        redrawTimer_ = 0; return true;
+      });
+
+      return;
     }
-    else if (c1 == 'C') { // right
-      event.setType(CKEY_TYPE_Right);
+  }
+
+  redraw();
+
+  lastRedraw_ = Clock::now();
+}
+
+void
+CTermApp::
+inputChar(unsigned char c)
+{
+  if (c == '\034') { // control backslash
+    resetRaw(inputFd_);
+    exit(1);
+  }
+
+  processChar(c);
+}
+
+void
+CTermApp::
+inputAltChar(unsigned char c)
+{
+  processChar(c, CMODIFIER_ALT);
+}
+
+void
+CTermApp::
+inputKey(CKeyType type, CEventModifier modifiers)
+{
+  text_.clear();
+
+  keyEvent_.setType     (type);
+  keyEvent_.setModifiers(modifiers);
+  keyEvent_.setText     (text_);
+
+  keyPress(keyEvent_);
+}
+
+void
+CTermApp::
+updateWindowSize()
+{
+  struct winsize ws;
+
+  bool charValid = false;
+
+  if (::ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 || ::ioctl(inputFd_, TIOCGWINSZ, &ws) == 0) {
+    if (ws.ws_row > 0 && ws.ws_col > 0) {
+      windowRows_ = ws.ws_row;
+      windowCols_ = ws.ws_col;
+
+      charValid = true;
     }
-    else if (c1 == 'D') { // left
-      event.setType(CKEY_TYPE_Left);
+
+    if (ws.ws_xpixel > 0 && ws.ws_ypixel > 0) {
+      windowWidth_  = ws.ws_xpixel;
+      windowHeight_ = ws.ws_ypixel;
     }
+  }
 
-    inEscape_ = false;
+  // only ask terminal when main loop will read the report
+  if (! charValid && running_)
+    COSRead::write(STDOUT_FILENO, CEscape::windowOpReportCharSize());
+}
 
-    keyPress(event);
+void
+CTermApp::
+requestPixelSize()
+{
+  // only ask terminal when main loop will read the report
+  if (running_)
+    COSRead::write(STDOUT_FILENO, CEscape::windowOpReportPixelSize());
+}
 
-    return true;
+// window size reports (CSI 8 ; <rows> ; <cols> t and CSI 4 ; <height> ; <width> t)
+void
+CTermApp::
+inputCSI(char marker, const int *params, int numParams, char final)
+{
+  if (marker != 0 || final != 't' || numParams != 3)
+    return;
+
+  if (params[1] <= 0 || params[2] <= 0)
+    return;
+
+  if      (params[0] == 8) {
+    windowRows_ = params[1];
+    windowCols_ = params[2];
+  }
+  else if (params[0] == 4) {
+    windowHeight_ = params[1];
+    windowWidth_  = params[2];
   }
 }
 
+// mouse report to press/release event at cell (1 based), buttons are
+// 1-3 and wheel up/down is 4/5 (press only)
 void
 CTermApp::
-processChar(unsigned char c)
+inputMouse(int button, int col, int row, bool release)
 {
-  CKeyEvent event;
-
-  switch (c) {
-    case 0     : event.setType(CKEY_TYPE_NUL); break;
-    case ''  : event.setType(CKEY_TYPE_SOH); break;
-    case ''  : event.setType(CKEY_TYPE_STX); break;
-    case ''  : event.setType(CKEY_TYPE_ETX); break;
-    case ''  : event.setType(CKEY_TYPE_EOT); break;
-    case ''  : event.setType(CKEY_TYPE_ENQ); break;
-    case ''  : event.setType(CKEY_TYPE_ACK); break;
-    case ''  : event.setType(CKEY_TYPE_BEL); break;
-    case ''  : event.setType(CKEY_TYPE_BackSpace); break;
-    case '\011': event.setType(CKEY_TYPE_TAB); break;
-    case '\012': event.setType(CKEY_TYPE_LineFeed); break;
-    case ''  : event.setType(CKEY_TYPE_Clear); break;
-    case ''  : event.setType(CKEY_TYPE_FF); break;
-    case '\015': event.setType(CKEY_TYPE_Return); break;
-    case ''  : event.setType(CKEY_TYPE_SO); break;
-    case ''  : event.setType(CKEY_TYPE_SI); break;
-    case ''  : event.setType(CKEY_TYPE_DLE); break;
-    case '\021': event.setType(CKEY_TYPE_DC1); break;
-    case ''  : event.setType(CKEY_TYPE_DC2); break;
-    case '\023': event.setType(CKEY_TYPE_Pause); break;
-    case ''  : event.setType(CKEY_TYPE_Scroll_Lock); break;
-    case ''  : event.setType(CKEY_TYPE_Sys_Req); break;
-    case ''  : event.setType(CKEY_TYPE_SYN); break;
-    case ''  : event.setType(CKEY_TYPE_ETB); break;
-    case ''  : event.setType(CKEY_TYPE_CAN); break;
-    case ''  : event.setType(CKEY_TYPE_EM); break;
-    case ''  : event.setType(CKEY_TYPE_SUB); break;
-    case '\033': event.setType(CKEY_TYPE_Escape); break;
-    case '\034': event.setType(CKEY_TYPE_FS); break;
-    case '\035': event.setType(CKEY_TYPE_GS); break;
-    case '\036': event.setType(CKEY_TYPE_RS); break;
-    case '\037': event.setType(CKEY_TYPE_US); break;
-    case ' '   : event.setType(CKEY_TYPE_Space); break;
-    case '!'   : event.setType(CKEY_TYPE_Space); break;
-    case '\"'  : event.setType(CKEY_TYPE_QuoteDbl); break;
-    case '#'   : event.setType(CKEY_TYPE_NumberSign); break;
-    case '$'   : event.setType(CKEY_TYPE_Dollar); break;
-    case '%'   : event.setType(CKEY_TYPE_Percent); break;
-    case '&'   : event.setType(CKEY_TYPE_Ampersand); break;
-    case '\''  : event.setType(CKEY_TYPE_Apostrophe); break;
-    case '('   : event.setType(CKEY_TYPE_ParenLeft); break;
-    case ')'   : event.setType(CKEY_TYPE_ParenRight); break;
-    case '*'   : event.setType(CKEY_TYPE_Asterisk); break;
-    case '+'   : event.setType(CKEY_TYPE_Plus); break;
-    case ','   : event.setType(CKEY_TYPE_Comma); break;
-    case '-'   : event.setType(CKEY_TYPE_Minus); break;
-    case '.'   : event.setType(CKEY_TYPE_Period); break;
-    case '/'   : event.setType(CKEY_TYPE_Slash); break;
-    case '0'   : event.setType(CKEY_TYPE_0); break;
-    case '1'   : event.setType(CKEY_TYPE_1); break;
-    case '2'   : event.setType(CKEY_TYPE_2); break;
-    case '3'   : event.setType(CKEY_TYPE_3); break;
-    case '4'   : event.setType(CKEY_TYPE_4); break;
-    case '5'   : event.setType(CKEY_TYPE_5); break;
-    case '6'   : event.setType(CKEY_TYPE_6); break;
-    case '7'   : event.setType(CKEY_TYPE_7); break;
-    case '8'   : event.setType(CKEY_TYPE_8); break;
-    case '9'   : event.setType(CKEY_TYPE_9); break;
-    case ':'   : event.setType(CKEY_TYPE_Colon); break;
-    case ';'   : event.setType(CKEY_TYPE_Semicolon); break;
-    case '<'   : event.setType(CKEY_TYPE_Less); break;
-    case '='   : event.setType(CKEY_TYPE_Equal); break;
-    case '>'   : event.setType(CKEY_TYPE_Greater); break;
-    case '?'   : event.setType(CKEY_TYPE_Question); break;
-    case '@'   : event.setType(CKEY_TYPE_At); break;
-    case 'A'   : event.setType(CKEY_TYPE_A); break;
-    case 'B'   : event.setType(CKEY_TYPE_B); break;
-    case 'C'   : event.setType(CKEY_TYPE_C); break;
-    case 'D'   : event.setType(CKEY_TYPE_D); break;
-    case 'E'   : event.setType(CKEY_TYPE_E); break;
-    case 'F'   : event.setType(CKEY_TYPE_F); break;
-    case 'G'   : event.setType(CKEY_TYPE_G); break;
-    case 'H'   : event.setType(CKEY_TYPE_H); break;
-    case 'I'   : event.setType(CKEY_TYPE_I); break;
-    case 'J'   : event.setType(CKEY_TYPE_J); break;
-    case 'K'   : event.setType(CKEY_TYPE_K); break;
-    case 'L'   : event.setType(CKEY_TYPE_L); break;
-    case 'M'   : event.setType(CKEY_TYPE_M); break;
-    case 'N'   : event.setType(CKEY_TYPE_N); break;
-    case 'O'   : event.setType(CKEY_TYPE_O); break;
-    case 'P'   : event.setType(CKEY_TYPE_P); break;
-    case 'Q'   : event.setType(CKEY_TYPE_Q); break;
-    case 'R'   : event.setType(CKEY_TYPE_R); break;
-    case 'S'   : event.setType(CKEY_TYPE_S); break;
-    case 'T'   : event.setType(CKEY_TYPE_T); break;
-    case 'U'   : event.setType(CKEY_TYPE_U); break;
-    case 'V'   : event.setType(CKEY_TYPE_V); break;
-    case 'W'   : event.setType(CKEY_TYPE_W); break;
-    case 'X'   : event.setType(CKEY_TYPE_X); break;
-    case 'Y'   : event.setType(CKEY_TYPE_Y); break;
-    case 'Z'   : event.setType(CKEY_TYPE_Z); break;
-    case '['   : event.setType(CKEY_TYPE_BracketLeft); break;
-    case '\\'  : event.setType(CKEY_TYPE_Backslash); break;
-    case ']'   : event.setType(CKEY_TYPE_BracketRight); break;
-    case '~'   : event.setType(CKEY_TYPE_AsciiCircum); break;
-    case '_'   : event.setType(CKEY_TYPE_Underscore); break;
-    case '`'   : event.setType(CKEY_TYPE_QuoteLeft); break;
-    case 'a'   : event.setType(CKEY_TYPE_a); break;
-    case 'b'   : event.setType(CKEY_TYPE_b); break;
-    case 'c'   : event.setType(CKEY_TYPE_c); break;
-    case 'd'   : event.setType(CKEY_TYPE_d); break;
-    case 'e'   : event.setType(CKEY_TYPE_e); break;
-    case 'f'   : event.setType(CKEY_TYPE_f); break;
-    case 'g'   : event.setType(CKEY_TYPE_g); break;
-    case 'h'   : event.setType(CKEY_TYPE_h); break;
-    case 'i'   : event.setType(CKEY_TYPE_i); break;
-    case 'j'   : event.setType(CKEY_TYPE_j); break;
-    case 'k'   : event.setType(CKEY_TYPE_k); break;
-    case 'l'   : event.setType(CKEY_TYPE_l); break;
-    case 'm'   : event.setType(CKEY_TYPE_m); break;
-    case 'n'   : event.setType(CKEY_TYPE_n); break;
-    case 'o'   : event.setType(CKEY_TYPE_o); break;
-    case 'p'   : event.setType(CKEY_TYPE_p); break;
-    case 'q'   : event.setType(CKEY_TYPE_q); break;
-    case 'r'   : event.setType(CKEY_TYPE_r); break;
-    case 's'   : event.setType(CKEY_TYPE_s); break;
-    case 't'   : event.setType(CKEY_TYPE_t); break;
-    case 'u'   : event.setType(CKEY_TYPE_u); break;
-    case 'v'   : event.setType(CKEY_TYPE_v); break;
-    case 'w'   : event.setType(CKEY_TYPE_w); break;
-    case 'x'   : event.setType(CKEY_TYPE_x); break;
-    case 'y'   : event.setType(CKEY_TYPE_y); break;
-    case 'z'   : event.setType(CKEY_TYPE_z); break;
-    case '{'   : event.setType(CKEY_TYPE_BraceLeft); break;
-    case '|'   : event.setType(CKEY_TYPE_Bar); break;
-    case '}'   : event.setType(CKEY_TYPE_BraceRight); break;
-    case 0x7f  : event.setType(CKEY_TYPE_DEL); break;
-    default    : break;
+  // ignore motion (drag) reports
+  if (button & 32)
+    return;
+
+  CIPoint2D pos(col, row);
+
+  if (! release) {
+    if (button & 64)
+      pressButton_ = 4 + (button & 1);
+    else
+      pressButton_ = (button & 3) + 1;
+
+    CMouseEvent event(pos, CMouseButton(pressButton_));
+
+    mousePress(event);
+  }
+  else {
+    CMouseEvent event(pos, CMouseButton(pressButton_));
+
+    mouseRelease(event);
   }
+}
+
+void
+CTermApp::
+processChar(unsigned char c, CEventModifier modifiers)
+{
+  // reuse event (single char text fits in string's inline buffer so decoding
+  // a burst of input does not allocate)
+  keyEvent_.setType     (s_keyTable[c]);
+  keyEvent_.setModifiers(modifiers);
 
   if (c >= ' ' && c <= '}')
-    event.setText(std::string(reinterpret_cast<char *>(&c), 1));
+    text_.assign(1, char(c));
+  else
+    text_.clear();
+
+  keyEvent_.setText(text_);
 
-  keyPress(event);
+  keyPress(keyEvent_);
 }
 
 bool
@@ -388,11 +805,11 @@ runCommand(const std::string &cmd)
 
   std::string cmd1 = cmd + "\n";
 
-  resetRaw(STDIN_FILENO);
+  resetRaw(inputFd_);
 
   COSRead::write(fd, cmd1.c_str());
 
   COSRead::write(2, cmd1.c_str());
 
-  setRaw(STDIN_FILENO);
+  setRaw(inputFd_);
 }
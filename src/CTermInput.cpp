@@ -0,0 +1,328 @@
+#include <CTermInput.h>
+
+#include <array>
+
+namespace {
+
+using State = CTermInput::State;
+
+enum class Action : unsigned char {
+  NONE,
+  CHAR,         // plain byte
+  ESC_KEY,      // escape then escape (first is Escape key)
+  ESC_CHAR,     // escape then control byte (Escape key and byte)
+  ALT_CHAR,     // escape then printable byte
+  CSI_CLEAR,    // start CSI
+  CSI_PARAM,    // parameter digit
+  CSI_SEP,      // parameter separator
+  CSI_MARKER,   // private marker
+  CSI_COLLECT,  // intermediate byte
+  CSI_DISPATCH, // final byte
+  SS3_DISPATCH, // final byte
+  MOUSE_BYTE    // X10 mouse report byte
+};
+
+struct Transition {
+  Action action { Action::NONE };
+  State  next   { State::GROUND };
+};
+
+constexpr int numStates = int(State::MOUSE) + 1;
+
+using Row   = std::array<Transition, 256>;
+using Table = std::array<Row, numStates>;
+
+constexpr void setRange(Row &row, int c1, int c2, Action action, State next) {
+  for (int c = c1; c <= c2; ++c)
+    row[size_t(c)] = Transition { action, next };
+}
+
+constexpr Table makeTable() {
+  Table table {};
+
+  // ground
+  auto &ground = table[size_t(State::GROUND)];
+
+  setRange(ground, 0x00, 0xff, Action::CHAR, State::GROUND);
+  setRange(ground, 0x1b, 0x1b, Action::NONE, State::ESCAPE);
+
+  // escape
+  auto &escape = table[size_t(State::ESCAPE)];
+
+  setRange(escape, 0x00, 0xff, Action::ESC_CHAR , State::GROUND);
+  setRange(escape, 0x20, 0x7f, Action::ALT_CHAR , State::GROUND);
+  setRange(escape, 0x1b, 0x1b, Action::ESC_KEY  , State::ESCAPE);
+  setRange(escape, '[' , '[' , Action::CSI_CLEAR, State::CSI   );
+  setRange(escape, 'O' , 'O' , Action::NONE     , State::SS3   );
+  setRange(escape, ']' , ']' , Action::NONE     , State::STRING); // OSC
+  setRange(escape, 'P' , 'P' , Action::NONE     , State::STRING); // DCS
+  setRange(escape, 'X' , 'X' , Action::NONE     , State::STRING); // SOS
+  setRange(escape, '^' , '^' , Action::NONE     , State::STRING); // PM
+  setRange(escape, '_' , '_' , Action::NONE     , State::STRING); // APC
+
+  // control sequence (controls are executed, CAN/SUB abort)
+  auto &csi = table[size_t(State::CSI)];
+
+  setRange(csi, 0x00, 0xff, Action::NONE        , State::CSI   );
+  setRange(csi, 0x00, 0x1f, Action::CHAR        , State::CSI   );
+  setRange(csi, 0x18, 0x18, Action::NONE        , State::GROUND);
+  setRange(csi, 0x1a, 0x1a, Action::NONE        , State::GROUND);
+  setRange(csi, 0x1b, 0x1b, Action::NONE        , State::ESCAPE);
+  setRange(csi, 0x20, 0x2f, Action::CSI_COLLECT , State::CSI   );
+  setRange(csi, '0' , '9' , Action::CSI_PARAM   , State::CSI   );
+  setRange(csi, ':' , ';' , Action::CSI_SEP     , State::CSI   );
+  setRange(csi, '<' , '?' , Action::CSI_MARKER  , State::CSI   );
+  setRange(csi, 0x40, 0x7e, Action::CSI_DISPATCH, State::GROUND);
+
+  // single shift 3 (one final byte)
+  auto &ss3 = table[size_t(State::SS3)];
+
+  setRange(ss3, 0x00, 0xff, Action::NONE        , State::GROUND);
+  setRange(ss3, 0x1b, 0x1b, Action::NONE        , State::ESCAPE);
+  setRange(ss3, 0x40, 0x7e, Action::SS3_DISPATCH, State::GROUND);
+
+  // string (ended by BEL or ST)
+  auto &str = table[size_t(State::STRING)];
+
+  setRange(str, 0x00, 0xff, Action::NONE, State::STRING       );
+  setRange(str, 0x07, 0x07, Action::NONE, State::GROUND       );
+  setRange(str, 0x18, 0x18, Action::NONE, State::GROUND       );
+  setRange(str, 0x1a, 0x1a, Action::NONE, State::GROUND       );
+  setRange(str, 0x1b, 0x1b, Action::NONE, State::STRING_ESCAPE);
+
+  auto &strEscape = table[size_t(State::STRING_ESCAPE)];
+
+  setRange(strEscape, 0x00, 0xff, Action::NONE, State::STRING       );
+  setRange(strEscape, 0x1b, 0x1b, Action::NONE, State::STRING_ESCAPE);
+  setRange(strEscape, '\\', '\\', Action::NONE, State::GROUND       );
+
+  // mouse report bytes
+  auto &mouse = table[size_t(State::MOUSE)];
+
+  setRange(mouse, 0x00, 0xff, Action::MOUSE_BYTE, State::MOUSE);
+
+  return table;
+}
+
+constexpr Table s_table = makeTable();
+
+// key for CSI/SS3 final byte (CKEY_TYPE_NUL if none)
+CKeyType finalKey(unsigned char c) {
+  switch (c) {
+    case 'A': return CKEY_TYPE_Up;
+    case 'B': return CKEY_TYPE_Down;
+    case 'C': return CKEY_TYPE_Right;
+    case 'D': return CKEY_TYPE_Left;
+    case 'E': return CKEY_TYPE_Begin;
+    case 'F': return CKEY_TYPE_End;
+    case 'H': return CKEY_TYPE_Home;
+    case 'P': return CKEY_TYPE_F1;
+    case 'Q': return CKEY_TYPE_F2;
+    case 'R': return CKEY_TYPE_F3;
+    case 'S': return CKEY_TYPE_F4;
+    case 'Z': return CKEY_TYPE_TAB; // back tab
+    default : return CKEY_TYPE_NUL;
+  }
+}
+
+// key for CSI <n> ~ (CKEY_TYPE_NUL if none)
+CKeyType tildeKey(int n) {
+  switch (n) {
+    case  1: return CKEY_TYPE_Home;
+    case  2: return CKEY_TYPE_Insert;
+    case  3: return CKEY_TYPE_Delete;
+    case  4: return CKEY_TYPE_End;
+    case  5: return CKEY_TYPE_Page_Up;
+    case  6: return CKEY_TYPE_Page_Down;
+    case  7: return CKEY_TYPE_Home;
+    case  8: return CKEY_TYPE_End;
+    case 11: return CKEY_TYPE_F1;
+    case 12: return CKEY_TYPE_F2;
+    case 13: return CKEY_TYPE_F3;
+    case 14: return CKEY_TYPE_F4;
+    case 15: return CKEY_TYPE_F5;
+    case 17: return CKEY_TYPE_F6;
+    case 18: return CKEY_TYPE_F7;
+    case 19: return CKEY_TYPE_F8;
+    case 20: return CKEY_TYPE_F9;
+    case 21: return CKEY_TYPE_F10;
+    case 23: return CKEY_TYPE_F11;
+    case 24: return CKEY_TYPE_F12;
+    default: return CKEY_TYPE_NUL;
+  }
+}
+
+}
+
+//---
+
+void
+CTermInput::
+put(unsigned char c)
+{
+  const auto &t = s_table[size_t(state_)][c];
+
+  // action may change state (e.g. CSI M starts mouse report)
+  state_ = t.next;
+
+  switch (t.action) {
+    case Action::NONE:
+      break;
+    case Action::CHAR:
+      handler_->inputChar(c);
+      break;
+    case Action::ESC_KEY:
+      handler_->inputChar(0x1b);
+      break;
+    case Action::ESC_CHAR:
+      handler_->inputChar(0x1b);
+      handler_->inputChar(c);
+      break;
+    case Action::ALT_CHAR:
+      handler_->inputAltChar(c);
+      break;
+    case Action::CSI_CLEAR:
+      numParams_    = 0;
+      marker_       = 0;
+      intermediate_ = 0;
+      break;
+    case Action::CSI_PARAM: {
+      if (numParams_ == 0) {
+        params_[0] = 0;
+        numParams_ = 1;
+      }
+
+      int &param = params_[numParams_ - 1];
+
+      if (param < 100000)
+        param = param*10 + (c - '0');
+
+      break;
+    }
+    case Action::CSI_SEP:
+      // empty first parameter is 0
+      if (numParams_ == 0) {
+        params_[0] = 0;
+        numParams_ = 1;
+      }
+
+      if (numParams_ < MAX_PARAMS)
+        params_[numParams_++] = 0;
+
+      break;
+    case Action::CSI_MARKER:
+      marker_ = char(c);
+      break;
+    case Action::CSI_COLLECT:
+      intermediate_ = char(c);
+      break;
+    case Action::CSI_DISPATCH:
+      dispatchCSI(c);
+      break;
+    case Action::SS3_DISPATCH:
+      dispatchSS3(c);
+      break;
+    case Action::MOUSE_BYTE:
+      mouse_[mouseLen_++] = c;
+
+      if (mouseLen_ == 3) {
+        state_ = State::GROUND;
+
+        // release is button 3 (wheel is 64 or 65)
+        int  button  = mouse_[0] - 32;
+        bool release = ((button & 0x43) == 3);
+
+        handler_->inputMouse(button, mouse_[1] - 32, mouse_[2] - 32, release);
+      }
+
+      break;
+  }
+}
+
+void
+CTermInput::
+flush()
+{
+  // escape not followed by anything in same read is Escape key
+  if (state_ == State::ESCAPE) {
+    state_ = State::GROUND;
+
+    handler_->inputChar(0x1b);
+  }
+}
+
+void
+CTermInput::
+dispatchCSI(unsigned char c)
+{
+  if (marker_ == 0 && intermediate_ == 0) {
+    // legacy mouse report (CSI M followed by three bytes)
+    if (c == 'M' && numParams_ == 0) {
+      state_    = State::MOUSE;
+      mouseLen_ = 0;
+      return;
+    }
+
+    // CSI [1;<mod>] <final>
+    CKeyType type = finalKey(c);
+
+    if (type != CKEY_TYPE_NUL) {
+      auto modifiers = paramModifiers(1);
+
+      if (c == 'Z')
+        modifiers = CEventModifier(modifiers | CMODIFIER_SHIFT);
+
+      handler_->inputKey(type, modifiers);
+
+      return;
+    }
+
+    // CSI <n>[;<mod>] ~
+    if (c == '~' && numParams_ > 0) {
+      type = tildeKey(params_[0]);
+
+      if (type != CKEY_TYPE_NUL) {
+        handler_->inputKey(type, paramModifiers(1));
+        return;
+      }
+    }
+  }
+
+  // SGR mouse report (CSI < <button> ; <col> ; <row> M, m for release)
+  if (marker_ == '<' && intermediate_ == 0 && (c == 'M' || c == 'm') && numParams_ == 3) {
+    handler_->inputMouse(params_[0], params_[1], params_[2], c == 'm');
+    return;
+  }
+
+  handler_->inputCSI(marker_, params_, numParams_, char(c));
+}
+
+void
+CTermInput::
+dispatchSS3(unsigned char c)
+{
+  CKeyType type = finalKey(c);
+
+  if (type != CKEY_TYPE_NUL && c != 'Z')
+    handler_->inputKey(type, CMODIFIER_NONE);
+}
+
+// modifiers for xterm modifier parameter (1 + shift|alt<<1|control<<2|meta<<3)
+CEventModifier
+CTermInput::
+paramModifiers(int i) const
+{
+  if (i >= numParams_ || params_[i] < 2)
+    return CMODIFIER_NONE;
+
+  int m = params_[i] - 1;
+
+  int modifiers = CMODIFIER_NONE;
+
+  if (m & 1) modifiers |= CMODIFIER_SHIFT;
+  if (m & 2) modifiers |= CMODIFIER_ALT;
+  if (m & 4) modifiers |= CMODIFIER_CONTROL;
+  if (m & 8) modifiers |= CMODIFIER_META;
+
+  return CEventModifier(modifiers);
+}
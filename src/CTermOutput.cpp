@@ -0,0 +1,101 @@
+#include <CTermOutput.h>
+
+#include <cerrno>
+#include <unistd.h>
+
+void
+CTermOutput::
+moveTo(int row, int col)
+{
+  // CSI <row> ; <col> H
+  buffer_ += "\033[";
+
+  appendInt(row);
+
+  buffer_ += ';';
+
+  appendInt(col);
+
+  buffer_ += 'H';
+}
+
+void
+CTermOutput::
+setSGR(int n)
+{
+  // CSI <n> m
+  buffer_ += "\033[";
+
+  appendInt(n);
+
+  buffer_ += 'm';
+}
+
+void
+CTermOutput::
+appendInt(int i)
+{
+  if (i < 0) {
+    buffer_ += '-';
+
+    i = -i;
+  }
+
+  char buf[16];
+  int  n = 0;
+
+  do {
+    buf[n++] = char('0' + i % 10);
+
+    i /= 10;
+  } while (i > 0);
+
+  while (n > 0)
+    buffer_ += buf[--n];
+}
+
+bool
+CTermOutput::
+flush()
+{
+  frameBytes_  = 0;
+  frameWrites_ = 0;
+
+  if (buffer_.empty())
+    return true;
+
+  const char *data = buffer_.data();
+  size_t      len  = buffer_.size();
+
+  bool rc = true;
+
+  // normally a single write, loop only on partial write or interrupt
+  while (len > 0) {
+    ssize_t n = ::write(fd_, data, len);
+
+    ++frameWrites_;
+
+    if (n < 0) {
+      if (errno == EINTR || errno == EAGAIN)
+        continue;
+
+      rc = false;
+
+      break;
+    }
+
+    data += n;
+    len  -= size_t(n);
+
+    frameBytes_ += size_t(n);
+  }
+
+  totalBytes_  += frameBytes_;
+  totalWrites_ += frameWrites_;
+
+  ++numFrames_;
+
+  buffer_.clear();
+
+  return rc;
+}
@@ -0,0 +1,342 @@
+#include <CTermScreen.h>
+#include <CTermOutput.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+struct Range {
+  char32_t c1, c2;
+};
+
+// combining marks and zero width characters
+const Range s_zeroWidth[] = {
+  { 0x0300, 0x036f }, { 0x0483, 0x0489 }, { 0x0591, 0x05bd }, { 0x0610, 0x061a },
+  { 0x064b, 0x065f }, { 0x0e31, 0x0e31 }, { 0x0e34, 0x0e3a }, { 0x0e47, 0x0e4e },
+  { 0x1ab0, 0x1aff }, { 0x1dc0, 0x1dff }, { 0x200b, 0x200f }, { 0x20d0, 0x20ff },
+  { 0xfe00, 0xfe0f }, { 0xfe20, 0xfe2f },
+};
+
+// east asian wide and emoji
+const Range s_wide[] = {
+  { 0x1100 , 0x115f  }, { 0x2e80 , 0x303e  }, { 0x3041 , 0x33ff  }, { 0x3400 , 0x4dbf  },
+  { 0x4e00 , 0x9fff  }, { 0xa000 , 0xa4cf  }, { 0xac00 , 0xd7a3  }, { 0xf900 , 0xfaff  },
+  { 0xfe30 , 0xfe4f  }, { 0xff00 , 0xff60  }, { 0xffe0 , 0xffe6  }, { 0x1f300, 0x1f64f },
+  { 0x1f900, 0x1f9ff }, { 0x20000, 0x3fffd },
+};
+
+template<size_t N>
+bool inRanges(const Range (&ranges)[N], char32_t c) {
+  for (const auto &range : ranges) {
+    if (c < range.c1) return false;
+    if (c <= range.c2) return true;
+  }
+
+  return false;
+}
+
+// display width of character (0 for combining mark, 2 for wide)
+int charWidth(char32_t c) {
+  if (c < 0x300)
+    return 1;
+
+  if (inRanges(s_zeroWidth, c))
+    return 0;
+
+  if (inRanges(s_wide, c))
+    return 2;
+
+  return 1;
+}
+
+// decode UTF-8 character at position (returns length, 0 if invalid)
+size_t decodeUtf8(std::string_view str, size_t i, char32_t &c) {
+  static const char32_t minValue[] = { 0, 0, 0x80, 0x800, 0x10000 };
+
+  auto b = static_cast<unsigned char>(str[i]);
+
+  size_t n;
+
+  if      ((b & 0xe0) == 0xc0) { n = 2; c = b & 0x1f; }
+  else if ((b & 0xf0) == 0xe0) { n = 3; c = b & 0x0f; }
+  else if ((b & 0xf8) == 0xf0) { n = 4; c = b & 0x07; }
+  else                         return 0;
+
+  if (i + n > str.size())
+    return 0;
+
+  for (size_t j = 1; j < n; ++j) {
+    auto b1 = static_cast<unsigned char>(str[i + j]);
+
+    if ((b1 & 0xc0) != 0x80)
+      return 0;
+
+    c = (c << 6) | (b1 & 0x3f);
+  }
+
+  // overlong, surrogate or out of range
+  if (c < minValue[n] || c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff))
+    return 0;
+
+  return n;
+}
+
+}
+
+void
+CTermScreen::
+resize(int rows, int cols)
+{
+  if (rows < 0) rows = 0;
+  if (cols < 0) cols = 0;
+
+  if (rows == rows_ && cols == cols_)
+    return;
+
+  rows_ = rows;
+  cols_ = cols;
+
+  front_.assign(size_t(rows_*cols_), Cell());
+  back_ .assign(size_t(rows_*cols_), Cell());
+
+  rowDirty_.assign(size_t(rows_), 0);
+
+  dirtyRows_.clear();
+
+  lastCell_ = nullptr;
+
+  valid_ = false;
+}
+
+void
+CTermScreen::
+clear()
+{
+  std::fill(back_.begin(), back_.end(), Cell());
+
+  for (int r = 1; r <= rows_; ++r)
+    setRowDirty(r);
+
+  row_ = 1;
+  col_ = 1;
+  sgr_ = 0;
+
+  lastCell_ = nullptr;
+}
+
+void
+CTermScreen::
+write(char c)
+{
+  write(std::string_view(&c, 1));
+}
+
+void
+CTermScreen::
+write(std::string_view str)
+{
+  static const char *replacement = "\xef\xbf\xbd"; // U+FFFD
+
+  for (size_t i = 0, n = str.size(); i < n; ) {
+    // ascii
+    if (static_cast<unsigned char>(str[i]) < 0x80) {
+      writeChar(&str[i], 1, 1);
+
+      ++i;
+
+      continue;
+    }
+
+    char32_t c;
+
+    size_t len = decodeUtf8(str, i, c);
+
+    // invalid byte drawn as replacement character
+    if (len == 0) {
+      writeChar(replacement, 3, 1);
+
+      ++i;
+
+      continue;
+    }
+
+    writeChar(&str[i], len, charWidth(c));
+
+    i += len;
+  }
+}
+
+void
+CTermScreen::
+write(const char *str)
+{
+  write(std::string_view(str));
+}
+
+// draw character of display width at current position
+void
+CTermScreen::
+writeChar(const char *text, size_t len, int width)
+{
+  // add combining mark to previous character (dropped if no room)
+  if (width == 0) {
+    if (lastCell_ && lastCell_->len + len <= MAX_CELL_BYTES) {
+      memcpy(lastCell_->text + lastCell_->len, text, len);
+
+      lastCell_->len += static_cast<unsigned char>(len);
+    }
+
+    return;
+  }
+
+  lastCell_ = nullptr;
+
+  // wide character in last column is drawn as space
+  if (width == 2 && col_ == cols_) {
+    text  = " ";
+    len   = 1;
+    width = 1;
+  }
+
+  auto *cell = backCell(row_, col_);
+
+  if (cell && (width == 1 || backCell(row_, col_ + 1))) {
+    // overwritten half of wide character is cleared
+    if (cell->width == 0) {
+      auto *lead = backCell(row_, col_ - 1);
+
+      if (lead)
+        *lead = Cell();
+    }
+
+    auto *next = backCell(row_, col_ + width);
+
+    if (next && next->width == 0)
+      *next = Cell();
+
+    memcpy(cell->text, text, len);
+
+    cell->len   = static_cast<unsigned char>(len);
+    cell->width = static_cast<unsigned char>(width);
+    cell->sgr   = sgr_;
+
+    // second half of wide character
+    if (width == 2) {
+      auto *cell2 = cell + 1;
+
+      cell2->len   = 0;
+      cell2->width = 0;
+      cell2->sgr   = sgr_;
+    }
+
+    lastCell_ = cell;
+
+    setRowDirty(row_);
+  }
+
+  col_ += width;
+}
+
+CTermScreen::Cell *
+CTermScreen::
+backCell(int row, int col)
+{
+  if (row < 1 || row > rows_ || col < 1 || col > cols_)
+    return nullptr;
+
+  return &back_[size_t((row - 1)*cols_ + col - 1)];
+}
+
+void
+CTermScreen::
+setRowDirty(int row)
+{
+  auto &dirty = rowDirty_[size_t(row - 1)];
+
+  if (! dirty) {
+    dirty = 1;
+
+    dirtyRows_.push_back(row);
+  }
+}
+
+const CTermScreen::Cell &
+CTermScreen::
+cell(int row, int col) const
+{
+  static Cell noCell;
+
+  if (row < 1 || row > rows_ || col < 1 || col > cols_)
+    return noCell;
+
+  return back_[size_t((row - 1)*cols_ + col - 1)];
+}
+
+void
+CTermScreen::
+render(CTermOutput &output)
+{
+  // full repaint starts from a cleared terminal
+  if (! valid_) {
+    output.setSGR(0);
+    output.write("\033[2J");
+
+    std::fill(front_.begin(), front_.end(), Cell());
+
+    // compare all rows
+    for (int r = 1; r <= rows_; ++r)
+      setRowDirty(r);
+
+    valid_ = true;
+  }
+
+  //---
+
+  int           outRow = -1, outCol = -1; // terminal cursor (unknown)
+  unsigned char outSGR = 0;
+
+  std::sort(dirtyRows_.begin(), dirtyRows_.end());
+
+  for (const auto &r : dirtyRows_) {
+    rowDirty_[size_t(r - 1)] = 0;
+
+    size_t i = size_t((r - 1)*cols_);
+
+    for (int c = 1; c <= cols_; ++c, ++i) {
+      const auto &cell = back_[i];
+
+      // second half of wide character is drawn with first half
+      if (cell.width == 0 || cell == front_[i])
+        continue;
+
+      if (r != outRow || c != outCol)
+        output.moveTo(r, c);
+
+      if (cell.sgr != outSGR) {
+        output.setSGR(0);
+
+        if (cell.sgr)
+          output.setSGR(cell.sgr);
+
+        outSGR = cell.sgr;
+      }
+
+      output.write(cell.str());
+
+      front_[i] = cell;
+
+      if (cell.width == 2)
+        front_[i + 1] = back_[i + 1];
+
+      // cursor position is unreliable after writing last column (pending wrap)
+      outRow = r;
+      outCol = (c + cell.width <= cols_ ? c + cell.width : -1);
+    }
+  }
+
+  dirtyRows_.clear();
+
+  if (outSGR)
+    output.setSGR(0);
+}
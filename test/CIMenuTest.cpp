@@ -1,18 +1,122 @@
 #include <CIMenu.h>
+#include <CIMenuMatch.h>
+#include <algorithm>
 #include <iostream>
+#include <chrono>
 #include <cstdio>
+#include <unistd.h>
+
+// time bulk add of generated items (item box only, no terminal app)
+static void
+benchAddItems(int n)
+{
+  CIMenuBox::Names names;
+
+  names.reserve(size_t(n));
+
+  for (int i = 0; i < n; ++i)
+    names.push_back("item" + std::to_string(i));
+
+  CIMenuBox box;
+
+  auto t1 = std::chrono::steady_clock::now();
+
+  box.addItems(std::move(names));
+
+  auto t2 = std::chrono::steady_clock::now();
+
+  box.clearItems();
+
+  auto t3 = std::chrono::steady_clock::now();
+
+  using MSecs = std::chrono::duration<double, std::milli>;
+
+  std::cerr << "addItems " << n << " : " << MSecs(t2 - t1).count() << "ms, " <<
+               "clearItems : " << MSecs(t3 - t2).count() << "ms\n";
+}
+
+// time matching query against generated items (naive case insensitive scan
+// vs each matcher, no terminal app)
+static void
+benchMatch(const std::string &query)
+{
+  int n = 1000000;
+
+  CIMenuBox::Names names;
+
+  names.reserve(size_t(n));
+
+  for (int i = 0; i < n; ++i)
+    names.push_back("src/module" + std::to_string(i % 100) + "/File_" + std::to_string(i) + ".cpp");
+
+  CIMenuBox box;
+
+  box.addItems(std::move(names));
+
+  using MSecs = std::chrono::duration<double, std::milli>;
+
+  auto timeMatch = [&](const char *name, auto match) {
+    int count = 0;
+
+    auto t1 = std::chrono::steady_clock::now();
+
+    for (const auto *item : box.items())
+      count += match(item->nameView());
+
+    auto t2 = std::chrono::steady_clock::now();
+
+    std::cerr << name << " : " << count << " matches, " << MSecs(t2 - t1).count() << "ms\n";
+  };
+
+  // same ASCII case folding as matchers
+  timeMatch("naive substr", [&](std::string_view name) {
+    auto equal = [](char c1, char c2) {
+      return CIMenuMatch::lowerChar(c1) == CIMenuMatch::lowerChar(c2); };
+
+    return std::search(name.begin(), name.end(), query.begin(), query.end(), equal) != name.end();
+  });
+
+  using Impl = CIMenuMatch::Impl;
+
+  for (auto impl : { Impl::SCALAR, Impl::SSE2, Impl::AVX2 }) {
+    if (int(impl) > int(CIMenuMatch::bestImpl()))
+      break;
+
+    CIMenuMatch::setImpl(impl);
+
+    std::string implName = CIMenuMatch::implName(impl);
+
+    timeMatch((implName + " substr").c_str(), [&](std::string_view name) {
+      return CIMenuMatch::containsSubstr(name, query);
+    });
+
+    timeMatch((implName + " subseq").c_str(), [&](std::string_view name) {
+      return CIMenuMatch::containsSubseq(name, query);
+    });
+  }
+
+  CIMenuMatch::setImpl(CIMenuMatch::bestImpl());
+}
 
 int
 main(int argc, char **argv)
 {
-  if (argc < 2) exit(1);
+  // items are read from stdin if it is not a terminal
+  bool readStdin = ! isatty(STDIN_FILENO);
 
-  using Items = std::vector<std::string>;
+  if (argc < 2 && ! readStdin) exit(1);
+
+  using Items = CIMenuBox::ItemDatas;
 
   std::string title;
+  std::string filename;
+  std::string historyFile;
   Items       items;
   bool        checkable = false;
   bool        border    = false;
+  bool        mouse     = false;
+  int         maxColumn = 1;
+  int         maxFps    = 0;
 
   for (int i = 1; i < argc; ++i) {
     if (argv[i][0] == '-') {
@@ -22,6 +126,8 @@ main(int argc, char **argv)
         checkable = true;
       else if (arg == "border")
         border = true;
+      else if (arg == "mouse")
+        mouse = true;
       else if (arg == "title") {
         ++i;
 
@@ -32,15 +138,86 @@ main(int argc, char **argv)
           exit(1);
         }
       }
+      else if (arg == "history") {
+        ++i;
+
+        if (i < argc)
+          historyFile = argv[i];
+        else {
+          std::cerr << "Missing value for '-" << arg << "'\n";
+          exit(1);
+        }
+      }
+      else if (arg == "fps") {
+        ++i;
+
+        if (i < argc)
+          maxFps = atoi(argv[i]);
+        else {
+          std::cerr << "Missing value for '-" << arg << "'\n";
+          exit(1);
+        }
+      }
+      else if (arg == "file") {
+        ++i;
+
+        if (i < argc)
+          filename = argv[i];
+        else {
+          std::cerr << "Missing value for '-" << arg << "'\n";
+          exit(1);
+        }
+      }
+      else if (arg == "bench") {
+        ++i;
+
+        if (i < argc)
+          benchAddItems(atoi(argv[i]));
+        else {
+          std::cerr << "Missing value for '-" << arg << "'\n";
+          exit(1);
+        }
+
+        exit(0);
+      }
+      else if (arg == "bench_match") {
+        ++i;
+
+        if (i < argc)
+          benchMatch(argv[i]);
+        else {
+          std::cerr << "Missing value for '-" << arg << "'\n";
+          exit(1);
+        }
+
+        exit(0);
+      }
       else {
         std::cerr << "Invalid arg '" << arg << "'\n";
         exit(1);
       }
     }
     else {
+      // item is <name>[:<column>]
       std::string item = argv[i];
 
-      items.push_back(item);
+      auto p = item.find(':');
+
+      if (p != std::string::npos) {
+        try {
+          int column = std::stoi(item.substr(p + 1));
+
+          maxColumn = std::max(maxColumn, column);
+
+          items.emplace_back(item.substr(0, p), "", column);
+
+          continue;
+        }
+        catch (...) {
+        }
+      }
+
+      items.emplace_back(std::move(item));
     }
   }
 
@@ -54,65 +231,42 @@ main(int argc, char **argv)
   if (checkable)
     menu->setCheckable(true);
 
-  //---
-
-  // set width
-  int width     = 0;
-  int maxColumn = 1;
-
-  for (const auto &item : items) {
-    auto p = item.find(':');
+  if (maxFps > 0)
+    menu->setMaxFrameRate(maxFps);
 
-    if (p != std::string::npos) {
-      try {
-        int column = std::stoi(item.substr(p + 1));
+  if (mouse)
+    menu->setMouse(true);
 
-        maxColumn = std::max(maxColumn, column);
-
-        width = std::max(width, int(p));
-      }
-      catch (...) {
-        width = std::max(width, int(item.size()));
-      }
-    }
-    else {
-      width = std::max(width, int(item.size()));
-    }
+  // history places initial cursor on most used item
+  if (historyFile != "") {
+    if (! menu->loadHistory(historyFile))
+      std::cerr << "Invalid history file '" << historyFile << "'\n";
   }
 
-  menu->setColumnWidth(width + 2);
-
   //---
 
   if (! title.empty()) {
-    CIMenuText *menuText = new CIMenuText(title);
+    auto *menuText = menu->createItem<CIMenuText>(title);
 
     menuText->setColumnSpan(maxColumn);
-
-    menu->addItem(menuText);
   }
 
-  for (const auto &item : items) {
-    auto p = item.find(':');
-
-    if (p != std::string::npos) {
-      try {
-        int column = std::stoi(item.substr(p + 1));
+  menu->addItems(std::move(items));
 
-        auto *menuItem = menu->addItem(item.substr(0, p));
-
-        if (menuItem)
-          menuItem->setColumn(column);
-      }
-      catch (...) {
-        menu->addItem(item);
-      }
-    }
-    else {
-      menu->addItem(item);
+  if (filename != "") {
+    if (! menu->addItemsFromFile(filename)) {
+      delete menu;
+      std::cerr << "Failed to read '" << filename << "'\n";
+      exit(1);
     }
   }
 
+  // set width
+  menu->setColumnWidth(menu->maxItemLength() + 2);
+
+  if (readStdin)
+    menu->readItems(STDIN_FILENO);
+
   menu->mainLoop();
 
   using Commands = std::vector<std::string>;
@@ -128,6 +282,9 @@ main(int argc, char **argv)
     commands = menu->checkedCommands();
   }
 
+  if (historyFile != "")
+    menu->recordHistory();
+
   //---
 
   // write result to file